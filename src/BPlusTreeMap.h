@@ -0,0 +1,775 @@
+#ifndef AISDI_MAPS_BPLUSTREEMAP_H
+#define AISDI_MAPS_BPLUSTREEMAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace aisdi
+{
+
+// Ordered map with the API of TreeMap, stored as a B+tree. Entries sit in leaves of about a
+// kilobyte (16 to 64 of them) linked into a list for iteration; inner nodes hold only separator
+// keys and child pointers, so a lookup in a big map touches a handful of nodes, each searched by
+// bisection, instead of one node per level of a binary tree. Keys have to be default
+// constructible and assignable, as inner nodes keep arrays of them. Entries are shifted between
+// slots after the nodes an insert needs are allocated, with no way back, so their moves must not
+// throw.
+// Entries move within and between leaves as the tree changes, so an insert or remove invalidates
+// every iterator.
+template <typename KeyType, typename ValueType>
+class BPlusTreeMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+
+  class ConstIterator;
+  class Iterator;
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+  static constexpr size_type LEAF_CAPACITY =
+    1024 / sizeof(value_type) < 16 ? 16 : 1024 / sizeof(value_type) > 64 ? 64 : 1024 / sizeof(value_type);
+  static constexpr size_type INNER_CAPACITY =
+    1024 / (sizeof(key_type) + sizeof(void*)) < 16 ? 16
+      : 1024 / (sizeof(key_type) + sizeof(void*)) > 64 ? 64 : 1024 / (sizeof(key_type) + sizeof(void*));
+
+protected:
+  static constexpr size_type MIN_LEAF = LEAF_CAPACITY / 2;
+  static constexpr size_type MIN_INNER = INNER_CAPACITY / 2;
+  // at least MIN_INNER + 1 children per inner node below the root; far more levels than any map needs
+  static constexpr size_type MAX_HEIGHT = 32;
+
+  using mutable_value_type = std::pair<key_type, mapped_type>;
+
+  static_assert(std::is_nothrow_move_constructible<mutable_value_type>::value,
+                "BPlusTreeMap relocates entries between slots, their moves must not throw");
+
+  // An entry is value_type to the user and a pair with a mutable key while it is moved between
+  // slots, the layout trick ordered maps over arrays rely on.
+  union Slot
+  {
+    value_type value;
+    mutable_value_type mutableValue;
+
+    Slot() {}
+    ~Slot() {}
+  };
+
+  // every node has room for one more item than its capacity: an insert lands first, then the
+  // overfull node is split in two
+  struct Leaf
+  {
+    size_type count;
+    Leaf* prev;
+    Leaf* next;
+    Slot slots[LEAF_CAPACITY + 1];
+
+    Leaf() : count(0), prev(nullptr), next(nullptr) {}
+  };
+
+  // keys[i] separates children[i], holding smaller keys, from children[i + 1]
+  struct Inner
+  {
+    size_type count;
+    key_type keys[INNER_CAPACITY + 1];
+    void* children[INNER_CAPACITY + 2];
+
+    Inner() : count(0) {}
+  };
+
+  // the inner nodes a descent went through and the child taken in each
+  struct Path
+  {
+    Inner* nodes[MAX_HEIGHT];
+    size_type indices[MAX_HEIGHT];
+    size_type depth;
+
+    Path() : depth(0) {}
+  };
+
+  void* root;
+  // levels of the tree, leaves included; 0 when empty
+  size_type height;
+  Leaf* firstLeaf;
+  Leaf* lastLeaf;
+  size_type treeSize;
+
+  static const key_type& keyOf(const Slot& slot) {
+    return slot.value.first;
+  }
+
+  // index of the first entry of leaf not less than key
+  static size_type lowerBound(const Leaf* leaf, const key_type& key) {
+    const Slot* found = std::lower_bound(leaf->slots, leaf->slots + leaf->count, key,
+                                         [](const Slot& slot, const key_type& k) { return keyOf(slot) < k; });
+    return static_cast<size_type>(found - leaf->slots);
+  }
+
+  // index of the child of inner whose subtree may hold key
+  static size_type childFor(const Inner* inner, const key_type& key) {
+    return static_cast<size_type>(std::upper_bound(inner->keys, inner->keys + inner->count, key) - inner->keys);
+  }
+
+  static void relocate(Slot& target, Slot& source) {
+    new (&target.mutableValue) mutable_value_type(std::move(source.mutableValue));
+    source.mutableValue.~mutable_value_type();
+  }
+
+  // moves count entries from source to target; the ranges may overlap
+  static void relocate(Slot* target, Slot* source, size_type count) {
+    if(target < source)
+      for(size_type i = 0; i < count; ++i)
+        relocate(target[i], source[i]);
+    else
+      for(size_type i = count; i-- > 0;)
+        relocate(target[i], source[i]);
+  }
+
+  // walks from the root to the leaf that holds or would hold key
+  Leaf* descend(const key_type& key, Path* path) const {
+    void* node = root;
+    for(size_type level = height; level > 1; --level) {
+      Inner* inner = static_cast<Inner*>(node);
+      size_type index = childFor(inner, key);
+      if(path) {
+        path->nodes[path->depth] = inner;
+        path->indices[path->depth++] = index;
+      }
+      node = inner->children[index];
+    }
+    return static_cast<Leaf*>(node);
+  }
+
+  void destroyNode(void* node, size_type level) {
+    if(level == 1) {
+      Leaf* leaf = static_cast<Leaf*>(node);
+      for(size_type i = 0; i < leaf->count; ++i)
+        leaf->slots[i].value.~value_type();
+      delete leaf;
+      return;
+    }
+    Inner* inner = static_cast<Inner*>(node);
+    for(size_type i = 0; i <= inner->count; ++i)
+      destroyNode(inner->children[i], level - 1);
+    delete inner;
+  }
+
+  // copies the subtree of node, linking its leaves after previous; frees the copy if it fails
+  void* cloneNode(const void* node, size_type level, Leaf*& previous) {
+    if(level == 1) {
+      const Leaf* source = static_cast<const Leaf*>(node);
+      Leaf* leaf = new Leaf();
+      try {
+        for(; leaf->count < source->count; ++leaf->count)
+          new (&leaf->slots[leaf->count].value) value_type(source->slots[leaf->count].value);
+      }
+      catch(...) {
+        destroyNode(leaf, 1);
+        throw;
+      }
+      leaf->prev = previous;
+      if(previous)
+        previous->next = leaf;
+      previous = leaf;
+      return leaf;
+    }
+
+    const Inner* source = static_cast<const Inner*>(node);
+    Inner* inner = new Inner();
+    size_type built = 0;
+    try {
+      std::copy(source->keys, source->keys + source->count, inner->keys);
+      for(; built <= source->count; ++built)
+        inner->children[built] = cloneNode(source->children[built], level - 1, previous);
+    }
+    catch(...) {
+      for(size_type i = 0; i < built; ++i)
+        destroyNode(inner->children[i], level - 1);
+      delete inner;
+      throw;
+    }
+    inner->count = source->count;
+    return inner;
+  }
+
+  void copyFrom(const BPlusTreeMap& other) {
+    if(!other.root)
+      return;
+    Leaf* previous = nullptr;
+    root = cloneNode(other.root, other.height, previous);
+    height = other.height;
+    treeSize = other.treeSize;
+    lastLeaf = previous;
+    firstLeaf = lastLeaf;
+    while(firstLeaf->prev)
+      firstLeaf = firstLeaf->prev;
+  }
+
+  // moves the upper half of an overfull leaf into right, which is linked after it
+  void splitLeaf(Leaf* leaf, Leaf* right) {
+    size_type moved = leaf->count / 2;
+    leaf->count -= moved;
+    relocate(right->slots, leaf->slots + leaf->count, moved);
+    right->count = moved;
+    right->prev = leaf;
+    right->next = leaf->next;
+    if(leaf->next)
+      leaf->next->prev = right;
+    else
+      lastLeaf = right;
+    leaf->next = right;
+  }
+
+  // links child right of key in inner, at the place a descent took through index
+  static void insertIntoInner(Inner* inner, size_type index, key_type& key, void* child) {
+    std::move_backward(inner->keys + index, inner->keys + inner->count, inner->keys + inner->count + 1);
+    std::move_backward(inner->children + index + 1, inner->children + inner->count + 1,
+                       inner->children + inner->count + 2);
+    inner->keys[index] = std::move(key);
+    inner->children[index + 1] = child;
+    ++inner->count;
+  }
+
+  // moves the upper half of an overfull inner node into right; the middle key goes into separator
+  static void splitInner(Inner* inner, Inner* right, key_type& separator) {
+    size_type middle = inner->count / 2;
+    separator = std::move(inner->keys[middle]);
+    right->count = inner->count - middle - 1;
+    std::move(inner->keys + middle + 1, inner->keys + inner->count, right->keys);
+    std::copy(inner->children + middle + 1, inner->children + inner->count + 1, right->children);
+    inner->count = middle;
+  }
+
+  // Places entry, which is not in the map, at pos of the leaf found along path. The entry is
+  // copied and every node a split may need is allocated before the tree is touched.
+  iterator insertAt(Path& path, Leaf* leaf, size_type pos, const_reference entry) {
+    Slot fresh;
+    new (&fresh.value) value_type(entry);
+
+    Leaf* rightLeaf = nullptr;
+    Inner* spares[MAX_HEIGHT + 1];
+    size_type spareCount = 0;
+    key_type separator;
+    try {
+      if(leaf->count == LEAF_CAPACITY) {
+        rightLeaf = new Leaf();
+        size_type depth = path.depth;
+        while(depth > 0 && path.nodes[depth - 1]->count == INNER_CAPACITY) {
+          spares[spareCount++] = new Inner();
+          --depth;
+        }
+        if(!depth)
+          spares[spareCount++] = new Inner();
+
+        // the first key of the right half, as it will be once entry is in
+        size_type first = (LEAF_CAPACITY + 1) - (LEAF_CAPACITY + 1) / 2;
+        separator = first < pos ? keyOf(leaf->slots[first]) : first == pos ? entry.first
+                                                                             : keyOf(leaf->slots[first - 1]);
+      }
+    }
+    catch(...) {
+      fresh.value.~value_type();
+      delete rightLeaf;
+      for(size_type i = 0; i < spareCount; ++i)
+        delete spares[i];
+      throw;
+    }
+
+    relocate(leaf->slots + pos + 1, leaf->slots + pos, leaf->count - pos);
+    relocate(leaf->slots[pos], fresh);
+    ++leaf->count;
+    ++treeSize;
+    if(!rightLeaf)
+      return iterator(this, leaf, pos);
+
+    splitLeaf(leaf, rightLeaf);
+    iterator result = pos < leaf->count ? iterator(this, leaf, pos) : iterator(this, rightLeaf, pos - leaf->count);
+
+    void* child = rightLeaf;
+    size_type used = 0;
+    for(size_type depth = path.depth; depth-- > 0;) {
+      Inner* inner = path.nodes[depth];
+      insertIntoInner(inner, path.indices[depth], separator, child);
+      if(inner->count <= INNER_CAPACITY)
+        return result;
+      Inner* right = spares[used++];
+      splitInner(inner, right, separator);
+      child = right;
+    }
+
+    Inner* newRoot = spares[used];
+    newRoot->count = 1;
+    newRoot->keys[0] = std::move(separator);
+    newRoot->children[0] = root;
+    newRoot->children[1] = child;
+    root = newRoot;
+    ++height;
+    return result;
+  }
+
+  iterator insert(const_reference entry) {
+    if(!root) {
+      Leaf* leaf = new Leaf();
+      try {
+        new (&leaf->slots[0].value) value_type(entry);
+      }
+      catch(...) {
+        delete leaf;
+        throw;
+      }
+      leaf->count = 1;
+      root = firstLeaf = lastLeaf = leaf;
+      height = 1;
+      treeSize = 1;
+      return iterator(this, leaf, 0);
+    }
+
+    Path path;
+    Leaf* leaf = descend(entry.first, &path);
+    size_type pos = lowerBound(leaf, entry.first);
+    if(pos < leaf->count && !(entry.first < keyOf(leaf->slots[pos])))
+      return iterator(this, leaf, pos);
+    return insertAt(path, leaf, pos, entry);
+  }
+
+  // drops the separator keys[index] and the child right of it
+  static void removeFromInner(Inner* inner, size_type index) {
+    std::move(inner->keys + index + 1, inner->keys + inner->count, inner->keys + index);
+    std::copy(inner->children + index + 2, inner->children + inner->count + 1, inner->children + index + 1);
+    --inner->count;
+  }
+
+  // appends right, the next leaf, to left and frees it
+  void mergeLeaves(Leaf* left, Leaf* right) {
+    relocate(left->slots + left->count, right->slots, right->count);
+    left->count += right->count;
+    left->next = right->next;
+    if(right->next)
+      right->next->prev = left;
+    else
+      lastLeaf = left;
+    delete right;
+  }
+
+  // the inner node at depth of path lost a child; borrows one from a sibling or merges with it
+  void rebalanceInner(Path& path, size_type depth) {
+    Inner* inner = path.nodes[depth];
+    if(!depth) {
+      if(!inner->count) {
+        root = inner->children[0];
+        --height;
+        delete inner;
+      }
+      return;
+    }
+    if(inner->count >= MIN_INNER)
+      return;
+
+    Inner* parent = path.nodes[depth - 1];
+    size_type index = path.indices[depth - 1];
+    Inner* left = index > 0 ? static_cast<Inner*>(parent->children[index - 1]) : nullptr;
+    Inner* right = index < parent->count ? static_cast<Inner*>(parent->children[index + 1]) : nullptr;
+
+    if(left && left->count > MIN_INNER) {
+      std::move_backward(inner->keys, inner->keys + inner->count, inner->keys + inner->count + 1);
+      std::move_backward(inner->children, inner->children + inner->count + 1, inner->children + inner->count + 2);
+      inner->keys[0] = std::move(parent->keys[index - 1]);
+      inner->children[0] = left->children[left->count];
+      parent->keys[index - 1] = std::move(left->keys[left->count - 1]);
+      --left->count;
+      ++inner->count;
+    }
+    else if(right && right->count > MIN_INNER) {
+      inner->keys[inner->count] = std::move(parent->keys[index]);
+      inner->children[inner->count + 1] = right->children[0];
+      parent->keys[index] = std::move(right->keys[0]);
+      std::move(right->keys + 1, right->keys + right->count, right->keys);
+      std::copy(right->children + 1, right->children + right->count + 1, right->children);
+      --right->count;
+      ++inner->count;
+    }
+    else {
+      size_type separator = left ? index - 1 : index;
+      if(left)
+        right = inner;
+      else
+        left = inner;
+      left->keys[left->count] = std::move(parent->keys[separator]);
+      std::move(right->keys, right->keys + right->count, left->keys + left->count + 1);
+      std::copy(right->children, right->children + right->count + 1, left->children + left->count + 1);
+      left->count += right->count + 1;
+      delete right;
+      removeFromInner(parent, separator);
+      rebalanceInner(path, depth - 1);
+    }
+  }
+
+  // removes the entry at pos of the leaf found along path, then refills or merges the leaf
+  void eraseAt(Path& path, Leaf* leaf, size_type pos) {
+    leaf->slots[pos].value.~value_type();
+    relocate(leaf->slots + pos, leaf->slots + pos + 1, leaf->count - pos - 1);
+    --leaf->count;
+    --treeSize;
+
+    if(height == 1) {
+      if(!leaf->count) {
+        delete leaf;
+        root = firstLeaf = lastLeaf = nullptr;
+        height = 0;
+      }
+      return;
+    }
+    if(leaf->count >= MIN_LEAF)
+      return;
+
+    Inner* parent = path.nodes[path.depth - 1];
+    size_type index = path.indices[path.depth - 1];
+    Leaf* left = index > 0 ? leaf->prev : nullptr;
+    Leaf* right = index < parent->count ? leaf->next : nullptr;
+
+    if(left && left->count > MIN_LEAF) {
+      relocate(leaf->slots + 1, leaf->slots, leaf->count);
+      relocate(leaf->slots[0], left->slots[left->count - 1]);
+      --left->count;
+      ++leaf->count;
+      parent->keys[index - 1] = keyOf(leaf->slots[0]);
+    }
+    else if(right && right->count > MIN_LEAF) {
+      relocate(leaf->slots[leaf->count], right->slots[0]);
+      relocate(right->slots, right->slots + 1, right->count - 1);
+      --right->count;
+      ++leaf->count;
+      parent->keys[index] = keyOf(right->slots[0]);
+    }
+    else {
+      size_type separator = left ? index - 1 : index;
+      if(left)
+        mergeLeaves(left, leaf);
+      else
+        mergeLeaves(leaf, right);
+      removeFromInner(parent, separator);
+      rebalanceInner(path, path.depth - 1);
+    }
+  }
+
+  // the leaf and index of key, or a null leaf
+  std::pair<Leaf*, size_type> findSlot(const key_type& key) const {
+    if(!root)
+      return std::make_pair(nullptr, 0);
+    Leaf* leaf = descend(key, nullptr);
+    size_type pos = lowerBound(leaf, key);
+    if(pos < leaf->count && !(key < keyOf(leaf->slots[pos])))
+      return std::make_pair(leaf, pos);
+    return std::make_pair(nullptr, 0);
+  }
+
+public:
+
+  BPlusTreeMap() : root(nullptr), height(0), firstLeaf(nullptr), lastLeaf(nullptr), treeSize(0) {}
+
+  BPlusTreeMap(std::initializer_list<value_type> list) : BPlusTreeMap() {
+    for(auto it = list.begin(); it != list.end(); ++it)
+      insert(*it);
+  }
+
+  // the copy keeps the shape of other, node for node
+  BPlusTreeMap(const BPlusTreeMap& other) : BPlusTreeMap() {
+    copyFrom(other);
+  }
+
+  BPlusTreeMap(BPlusTreeMap&& other) : BPlusTreeMap() {
+    swap(other);
+  }
+
+  BPlusTreeMap& operator=(const BPlusTreeMap& other) {
+    if(this == &other)
+      return *this;
+
+    BPlusTreeMap copy(other);
+    swap(copy);
+    return *this;
+  }
+
+  BPlusTreeMap& operator=(BPlusTreeMap&& other) {
+    if(this == &other)
+      return *this;
+
+    BPlusTreeMap toDel(std::move(*this));
+    swap(other);
+    return *this;
+  }
+
+  ~BPlusTreeMap() {
+    if(root)
+      destroyNode(root, height);
+  }
+
+  void swap(BPlusTreeMap& other) {
+    std::swap(root, other.root);
+    std::swap(height, other.height);
+    std::swap(firstLeaf, other.firstLeaf);
+    std::swap(lastLeaf, other.lastLeaf);
+    std::swap(treeSize, other.treeSize);
+  }
+
+  bool isEmpty() const {
+    return !root;
+  }
+
+  mapped_type& operator[](const key_type& key) {
+    iterator tmp = find(key);
+    if(tmp != end())
+      return tmp->second;
+    return insert(value_type(key, mapped_type{}))->second;
+  }
+
+  const mapped_type& valueOf(const key_type& key) const {
+    if(isEmpty())
+      throw std::out_of_range("valueOf in empty tree map");
+    const_iterator current = find(key);
+    if(current == cend())
+      throw std::out_of_range("ValueOf not existing element");
+    return current->second;
+  }
+
+  mapped_type& valueOf(const key_type& key) {
+    if(isEmpty())
+      throw std::out_of_range("valueOf in empty tree map");
+    iterator current = find(key);
+    if(current == end())
+      throw std::out_of_range("ValueOf not existing element");
+    return current->second;
+  }
+
+  const_iterator find(const key_type& key) const {
+    std::pair<Leaf*, size_type> slot = findSlot(key);
+    return const_iterator(this, slot.first, slot.second);
+  }
+
+  iterator find(const key_type& key) {
+    std::pair<Leaf*, size_type> slot = findSlot(key);
+    return iterator(this, slot.first, slot.second);
+  }
+
+  void remove(const key_type& key) {
+    if(isEmpty())
+      throw std::out_of_range("Attempt to remove element from empty tree map");
+
+    Path path;
+    Leaf* leaf = descend(key, &path);
+    size_type pos = lowerBound(leaf, key);
+    if(pos == leaf->count || key < keyOf(leaf->slots[pos]))
+      throw std::out_of_range("Remove element, which is not in tree");
+    eraseAt(path, leaf, pos);
+  }
+
+  void remove(const const_iterator& it) {
+    if(it == end())
+      throw std::out_of_range("Attempt to remove end iterator");
+
+    // the path down to the leaf is needed to refill it
+    Path path;
+    descend(keyOf(it.leaf->slots[it.index]), &path);
+    eraseAt(path, it.leaf, it.index);
+  }
+
+  size_type getSize() const {
+    return treeSize;
+  }
+
+  bool operator==(const BPlusTreeMap& other) const {
+    if(treeSize != other.treeSize)
+      return false;
+
+    for(const_iterator it = cbegin(), ot = other.cbegin(); ot != other.cend(); ++ot, ++it) {
+      if(*it != *ot)
+        return false;
+    }
+    return true;
+  }
+
+  bool operator!=(const BPlusTreeMap& other) const {
+    return !(*this == other);
+  }
+
+  iterator begin() {
+    return iterator(this, firstLeaf, 0);
+  }
+
+  iterator end() {
+    return iterator(this, nullptr, 0);
+  }
+
+  const_iterator cbegin() const {
+    return const_iterator(this, firstLeaf, 0);
+  }
+
+  const_iterator cend() const {
+    return const_iterator(this, nullptr, 0);
+  }
+
+  const_iterator begin() const {
+    return cbegin();
+  }
+
+  const_iterator end() const {
+    return cend();
+  }
+};
+
+template <typename KeyType, typename ValueType>
+constexpr typename BPlusTreeMap<KeyType, ValueType>::size_type BPlusTreeMap<KeyType, ValueType>::LEAF_CAPACITY;
+
+template <typename KeyType, typename ValueType>
+constexpr typename BPlusTreeMap<KeyType, ValueType>::size_type BPlusTreeMap<KeyType, ValueType>::INNER_CAPACITY;
+
+template <typename KeyType, typename ValueType>
+constexpr typename BPlusTreeMap<KeyType, ValueType>::size_type BPlusTreeMap<KeyType, ValueType>::MIN_LEAF;
+
+template <typename KeyType, typename ValueType>
+constexpr typename BPlusTreeMap<KeyType, ValueType>::size_type BPlusTreeMap<KeyType, ValueType>::MIN_INNER;
+
+template <typename KeyType, typename ValueType>
+constexpr typename BPlusTreeMap<KeyType, ValueType>::size_type BPlusTreeMap<KeyType, ValueType>::MAX_HEIGHT;
+
+// walks the leaf list: a step stays in its leaf or moves to the neighbouring one
+template <typename KeyType, typename ValueType>
+class BPlusTreeMap<KeyType, ValueType>::ConstIterator
+{
+public:
+  using reference = typename BPlusTreeMap::const_reference;
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = typename BPlusTreeMap::value_type;
+  using pointer = const typename BPlusTreeMap::value_type*;
+
+protected:
+  const BPlusTreeMap* tree;
+  Leaf* leaf;
+  size_type index;
+
+  friend class BPlusTreeMap<KeyType, ValueType>;
+
+public:
+  explicit ConstIterator(const BPlusTreeMap* tree, Leaf* leaf, size_type index) :
+    tree(tree), leaf(leaf), index(index) {}
+
+  ConstIterator(const ConstIterator& other) = default;
+
+  ConstIterator& operator=(const ConstIterator& other) = default;
+
+  ConstIterator& operator++() {
+    if(!leaf)
+      throw std::out_of_range("Attempt to increment end iterator");
+
+    if(++index == leaf->count) {
+      leaf = leaf->next;
+      index = 0;
+    }
+    return *this;
+  }
+
+  ConstIterator operator++(int) {
+    auto ret = *this;
+    operator++();
+    return ret;
+  }
+
+  ConstIterator& operator--() {
+    if(*this == tree->cbegin())
+      throw std::out_of_range("Attempt to decrement begin iterator");
+
+    if(!leaf)
+      leaf = tree->lastLeaf;
+    else if(index == 0)
+      leaf = leaf->prev;
+    else {
+      --index;
+      return *this;
+    }
+    index = leaf->count - 1;
+    return *this;
+  }
+
+  ConstIterator operator--(int) {
+    auto ret = *this;
+    operator--();
+    return ret;
+  }
+
+  reference operator*() const {
+    if(!leaf)
+      throw std::out_of_range("attempt to dereference end iterator");
+    return leaf->slots[index].value;
+  }
+
+  pointer operator->() const {
+    return &this->operator*();
+  }
+
+  bool operator==(const ConstIterator& other) const {
+    return leaf == other.leaf && index == other.index;
+  }
+
+  bool operator!=(const ConstIterator& other) const {
+    return !(*this == other);
+  }
+};
+
+template <typename KeyType, typename ValueType>
+class BPlusTreeMap<KeyType, ValueType>::Iterator : public BPlusTreeMap<KeyType, ValueType>::ConstIterator
+{
+public:
+  using reference = typename BPlusTreeMap::reference;
+  using pointer = typename BPlusTreeMap::value_type*;
+
+  explicit Iterator(BPlusTreeMap* tree, Leaf* leaf, size_type index) : ConstIterator(tree, leaf, index) {}
+
+  Iterator(const ConstIterator& other)
+    : ConstIterator(other)
+  {}
+
+  Iterator& operator++() {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int) {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--() {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int) {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  pointer operator->() const {
+    return &this->operator*();
+  }
+
+  reference operator*() const {
+    return const_cast<reference>(ConstIterator::operator*());
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_BPLUSTREEMAP_H */
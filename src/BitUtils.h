@@ -0,0 +1,60 @@
+#ifndef AISDI_MAPS_BITUTILS_H
+#define AISDI_MAPS_BITUTILS_H
+
+#include <cstdint>
+
+namespace aisdi
+{
+
+// word must not be zero
+inline unsigned countTrailingZeros(std::uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<unsigned>(__builtin_ctzll(word));
+#else
+  unsigned result = 0;
+  while(!(word & 1)) {
+    word >>= 1;
+    ++result;
+  }
+  return result;
+#endif
+}
+
+// word must not be zero
+inline unsigned countLeadingZeros(std::uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<unsigned>(__builtin_clzll(word));
+#else
+  unsigned result = 0;
+  while(!(word & (std::uint64_t(1) << 63))) {
+    word <<= 1;
+    ++result;
+  }
+  return result;
+#endif
+}
+
+// number of set bits
+inline unsigned countOnes(std::uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<unsigned>(__builtin_popcountll(word));
+#else
+  unsigned result = 0;
+  for(; word; word &= word - 1)
+    ++result;
+  return result;
+#endif
+}
+
+// hint that address will be read soon; does nothing where the compiler offers no builtin
+inline void prefetchRead(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(address, 0, 3);
+#else
+  (void)address;
+#endif
+}
+
+}
+
+#endif /* AISDI_MAPS_BITUTILS_H */
@@ -0,0 +1,921 @@
+#ifndef AISDI_MAPS_CHAINEDSTORAGE_H
+#define AISDI_MAPS_CHAINEDSTORAGE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "BitUtils.h"
+#include "HashMapStats.h"
+#include "HashMixing.h"
+#include "NodePool.h"
+#include "RedBlackTree.h"
+
+namespace aisdi
+{
+
+// Storage policy for HashMap: separate chaining, every bucket is a singly linked list of nodes.
+// Nodes come from a per-table NodePool, so inserts and removals rarely reach the system allocator.
+// A bitmap of non-empty buckets lets iteration skip 64 empty buckets per word.
+// The bucket count is a power of two; Hasher is expected to mix its bits (see HashMixing.h).
+// A chain that grows past TREEIFY_THRESHOLD nodes in a table of at least MIN_TREEIFY_BUCKETS buckets
+// becomes a tree bin: its nodes are rebuilt as red-black tree nodes ordered by hash, so a flood of
+// colliding keys costs O(log n) per lookup instead of O(n). The chain links stay for iteration.
+struct ChainedStorage
+{
+  template <typename Value, typename Hasher, typename KeyEqual>
+  class Table;
+};
+
+// Order of the entries with equal hashes in a tree bin. Keys compared with std::equal_to that have
+// operator< are ordered by std::less. Any other equality may disagree with every order of the keys,
+// so such ties stay unordered and a lookup has to search both sides of them.
+template <typename Key, typename KeyEqual, typename = void>
+struct TreeBinOrder : std::false_type
+{
+  static bool less(const Key&, const Key&) {
+    return false;
+  }
+};
+
+template <typename Key>
+struct TreeBinOrder<Key, std::equal_to<Key>,
+                    typename MakeVoid<decltype(std::declval<const Key&>() < std::declval<const Key&>())>::type> :
+  std::true_type
+{
+  static bool less(const Key& a, const Key& b) {
+    return std::less<Key>()(a, b);
+  }
+};
+
+template <typename Value, typename Hasher, typename KeyEqual>
+class ChainedStorage::Table
+{
+public:
+  using value_type = Value;
+  using key_type = typename std::remove_const<typename value_type::first_type>::type;
+  using size_type = std::size_t;
+
+protected:
+  // the full hash is kept next to the entry: chain walks compare it before the key, rebuilds and
+  // copies never call the hasher again
+  struct Node
+  {
+    Node* next;
+    std::size_t hash;
+    value_type data;
+
+    template <typename... Args>
+    explicit Node(Node* n, std::size_t h, Args&&... args) : next(n), hash(h), data(std::forward<Args>(args)...) {}
+  };
+
+  // node of a tree bin, prev makes unlinking it from the chain O(1)
+  struct TreeNode : Node, RedBlackLinks
+  {
+    Node* prev;
+
+    template <typename... Args>
+    explicit TreeNode(Node* n, std::size_t h, Args&&... args) :
+      Node(n, h, std::forward<Args>(args)...), RedBlackLinks(), prev(nullptr) {}
+  };
+
+  // an empty tree means the bucket is a plain chain
+  struct TreeBin
+  {
+    RedBlackTree tree;
+    size_type size;
+  };
+
+  using Order = TreeBinOrder<key_type, KeyEqual>;
+
+public:
+  // the end position has no node
+  struct Position
+  {
+    size_type index;
+    Node* node;
+
+    bool operator==(const Position& other) const {
+      return node == other.node;
+    }
+
+    bool operator!=(const Position& other) const {
+      return !(*this == other);
+    }
+  };
+  using position = Position;
+  // a lookup chases the bucket head and then its chain; prefetching both ahead of batched lookups
+  // measured no faster than finding the keys one by one, so batches are found one by one
+  using prefetches_batches = std::false_type;
+
+protected:
+  static constexpr size_type MIN_BUCKET_COUNT = 8;
+  static constexpr size_type WORD_BITS = 64;
+  static constexpr size_type TREEIFY_THRESHOLD = 8;
+  static constexpr size_type UNTREEIFY_THRESHOLD = 6;
+  static constexpr size_type MIN_TREEIFY_BUCKETS = 64;
+
+  Node** hashArray;
+  std::uint64_t* occupied;
+  TreeBin* trees;  // allocated with the first tree bin
+  NodePool<Node> pool;
+  NodePool<TreeNode> treePool;
+  size_type bucketCount;
+  size_type minimalHash, maximalHash;
+  size_type size;
+  float maxLoadFactor;
+  Hasher hasher;
+  KeyEqual keyEqual;
+  FindCounters counters;
+
+  // moves copy the source's hasher and key-equal and swap them, so they can throw only if those can
+  using nothrow_move = std::integral_constant<bool,
+    std::is_nothrow_copy_constructible<Hasher>::value && std::is_nothrow_copy_constructible<KeyEqual>::value &&
+    std::is_nothrow_move_assignable<Hasher>::value && std::is_nothrow_move_assignable<KeyEqual>::value>;
+
+  size_type bucketFor(size_type hash) const {
+    return hash & (bucketCount - 1);
+  }
+
+  // smallest power of two not lower than n
+  static size_type nextBucketCount(size_type n) {
+    size_type result = MIN_BUCKET_COUNT;
+    while(result < n) {
+      if(result > (static_cast<size_type>(-1) >> 2))
+        throw std::length_error("Bucket count exceeds hash map limits");
+      result *= 2;
+    }
+    return result;
+  }
+
+  static size_type wordsFor(size_type buckets) {
+    return (buckets + WORD_BITS - 1) / WORD_BITS;
+  }
+
+  void markOccupied(size_type index) {
+    occupied[index / WORD_BITS] |= std::uint64_t(1) << (index % WORD_BITS);
+  }
+
+  void markEmpty(size_type index) {
+    occupied[index / WORD_BITS] &= ~(std::uint64_t(1) << (index % WORD_BITS));
+  }
+
+  // first non-empty bucket at or after index, bucketCount if there is none
+  size_type nextOccupied(size_type index) const {
+    if(index >= bucketCount)
+      return bucketCount;
+    size_type word = index / WORD_BITS;
+    std::uint64_t bits = occupied[word] & (~std::uint64_t(0) << (index % WORD_BITS));
+    while(!bits) {
+      if(++word == wordsFor(bucketCount))
+        return bucketCount;
+      bits = occupied[word];
+    }
+    return word * WORD_BITS + countTrailingZeros(bits);
+  }
+
+  // last non-empty bucket before index, there has to be one
+  size_type prevOccupied(size_type index) const {
+    --index;
+    size_type word = index / WORD_BITS;
+    std::uint64_t bits = occupied[word] & (~std::uint64_t(0) >> (WORD_BITS - 1 - index % WORD_BITS));
+    while(!bits)
+      bits = occupied[--word];
+    return word * WORD_BITS + WORD_BITS - 1 - countLeadingZeros(bits);
+  }
+
+  size_type bucketsNeededFor(size_type elements) const {
+    return static_cast<size_type>(static_cast<double>(elements) / maxLoadFactor) + 1;
+  }
+
+  // both arrays come zeroed, nothing leaks when the second allocation fails
+  static void allocateBuckets(size_type count, Node**& array, std::uint64_t*& bits) {
+    bits = new std::uint64_t[wordsFor(count)]();
+    try {
+      array = new Node*[count]();
+    }
+    catch(...) {
+      delete [] bits;
+      throw;
+    }
+  }
+
+  // Relinks every node into a new bucket array of the given size, plain nodes stay put. Tree bins
+  // are turned back into chains first and rebuilt afterwards where the new chains are still long.
+  void rebuild(size_type newBucketCount) {
+    Node** newArray;
+    std::uint64_t* newOccupied;
+    allocateBuckets(newBucketCount, newArray, newOccupied);
+    // merging buckets is the only way a chain can get longer here
+    bool rebalance = trees || newBucketCount < bucketCount;
+    if(trees) {
+      try {
+        for(size_type i = nextOccupied(0); i < bucketCount; i = nextOccupied(i + 1))
+          if(isTreeBin(i))
+            untreeify(i);
+      }
+      catch(...) {
+        delete [] newArray;
+        delete [] newOccupied;
+        throw;
+      }
+      delete [] trees;
+      trees = nullptr;
+    }
+
+    Node** oldArray = hashArray;
+    std::uint64_t* oldOccupied = occupied;
+    size_type oldWords = wordsFor(bucketCount);
+
+    hashArray = newArray;
+    occupied = newOccupied;
+    bucketCount = newBucketCount;
+    minimalHash = newBucketCount - 1;
+    maximalHash = 0;
+
+    for(size_type word = 0; word < oldWords; ++word) {
+      for(std::uint64_t bits = oldOccupied[word]; bits; bits &= bits - 1) {
+        size_type i = word * WORD_BITS + countTrailingZeros(bits);
+        while(oldArray[i]) {
+          Node* node = oldArray[i];
+          oldArray[i] = node->next;
+          size_type hashIndex = bucketFor(node->hash);
+          node->next = hashArray[hashIndex];
+          hashArray[hashIndex] = node;
+          markOccupied(hashIndex);
+          if(minimalHash > hashIndex)
+            minimalHash = hashIndex;
+          if(maximalHash < hashIndex)
+            maximalHash = hashIndex;
+        }
+      }
+    }
+    if(!size)
+      minimalHash = maximalHash = 0;
+
+    delete [] oldArray;
+    delete [] oldOccupied;
+
+    if(rebalance && bucketCount >= MIN_TREEIFY_BUCKETS)
+      for(size_type i = nextOccupied(0); i < bucketCount; i = nextOccupied(i + 1))
+        balanceBucket(i);
+  }
+
+  // destroys every node and drops the tree bins, the bucket array and the pools' chunks are kept for reuse
+  void destroyNodes() {
+    for(size_type i = nextOccupied(0); i < bucketCount; i = nextOccupied(i + 1)) {
+      bool tree = isTreeBin(i);
+      while(hashArray[i]) {
+        Node* node = hashArray[i];
+        hashArray[i] = node->next;
+        if(tree)
+          treePool.destroy(asTree(node));
+        else
+          pool.destroy(node);
+      }
+    }
+    delete [] trees;
+    trees = nullptr;
+    std::fill(occupied, occupied + wordsFor(bucketCount), 0);
+    size = minimalHash = maximalHash = 0;
+  }
+
+  void destroyAll() {
+    destroyNodes();
+    delete [] hashArray;
+    delete [] occupied;
+    pool.release();
+    treePool.release();
+  }
+
+  bool isTreeBin(size_type index) const {
+    return trees && !trees[index].tree.isEmpty();
+  }
+
+  static TreeNode* asTree(Node* node) {
+    return static_cast<TreeNode*>(node);
+  }
+
+  static TreeNode* asTree(RedBlackLinks* links) {
+    return static_cast<TreeNode*>(links);
+  }
+
+  // tree bins order by hash first, see TreeBinOrder for equal hashes; probes counts visited nodes
+  TreeNode* findInTree(RedBlackLinks* at, size_type hash, const key_type& key, size_type& probes) const {
+    while(at) {
+      TreeNode* node = asTree(at);
+      ++probes;
+      if(hash != node->hash)
+        at = hash < node->hash ? at->left : at->right;
+      else if(keyEqual(key, node->data.first))
+        return node;
+      else if(Order::value)
+        at = Order::less(key, node->data.first) ? at->left : at->right;
+      else {
+        if(TreeNode* found = findInTree(at->right, hash, key, probes))
+          return found;
+        at = at->left;
+      }
+    }
+    return nullptr;
+  }
+
+  Node* findInBucket(size_type index, size_type hash, const key_type& key, size_type& probes) const {
+    if(isTreeBin(index))
+      return findInTree(trees[index].tree.getRoot(), hash, key, probes);
+    for(Node* node = hashArray[index]; node; node = node->next) {
+      ++probes;
+      if(node->hash == hash && keyEqual(key, node->data.first))
+        return node;
+    }
+    return nullptr;
+  }
+
+  Node* findInBucket(size_type index, size_type hash, const key_type& key) const {
+    size_type probes = 0;
+    return findInBucket(index, hash, key, probes);
+  }
+
+  void insertIntoTree(size_type index, TreeNode* node) {
+    RedBlackLinks* parent = nullptr;
+    bool asLeft = false;
+    for(RedBlackLinks* at = trees[index].tree.getRoot(); at; at = asLeft ? at->left : at->right) {
+      parent = at;
+      TreeNode* other = asTree(at);
+      asLeft = node->hash < other->hash ||
+               (node->hash == other->hash && Order::less(node->data.first, other->data.first));
+    }
+    trees[index].tree.insertAt(parent, asLeft, node);
+    ++trees[index].size;
+  }
+
+  size_type chainLength(size_type index) const {
+    size_type length = 0;
+    for(Node* node = hashArray[index]; node; node = node->next)
+      ++length;
+    return length;
+  }
+
+  // Moves every entry of the chain at index into a node from targetPool, keeping the chain order.
+  // All target nodes are allocated before any entry moves, so either the whole chain is replaced or,
+  // when allocating or copying throws, the chain is left as it was.
+  template <typename Target, typename Source>
+  void replaceChain(size_type index, NodePool<Source>& sourcePool, NodePool<Target>& targetPool) {
+    size_type length = chainLength(index);
+    std::vector<Target*> fresh;
+    fresh.reserve(length);
+    size_type built = 0;
+    try {
+      while(fresh.size() < length)
+        fresh.push_back(targetPool.allocate());
+      for(Node* node = hashArray[index]; node; node = node->next, ++built)
+        new (fresh[built]) Target(nullptr, node->hash, std::move_if_noexcept(node->data));
+    }
+    catch(...) {
+      for(size_type i = 0; i < built; ++i)
+        fresh[i]->~Target();
+      for(Target* node : fresh)
+        targetPool.deallocate(node);
+      throw;
+    }
+
+    Node** tail = &hashArray[index];
+    Node* node = hashArray[index];
+    for(Target* replacement : fresh) {
+      Node* next = node->next;
+      sourcePool.destroy(static_cast<Source*>(node));
+      *tail = replacement;
+      tail = &replacement->next;
+      node = next;
+    }
+  }
+
+  void treeify(size_type index) {
+    if(!trees)
+      trees = new TreeBin[bucketCount]();
+    replaceChain(index, pool, treePool);
+    Node* prev = nullptr;
+    for(Node* node = hashArray[index]; node; node = node->next) {
+      asTree(node)->prev = prev;
+      insertIntoTree(index, asTree(node));
+      prev = node;
+    }
+  }
+
+  void untreeify(size_type index) {
+    replaceChain(index, treePool, pool);
+    trees[index].tree.reset();
+    trees[index].size = 0;
+  }
+
+  // Turns the plain chain at index into a tree bin once it gets too long. Returns the position of
+  // the bucket's first entry, which is where link puts a new one. Failing to convert is not an
+  // error: the chain just stays a list until the next insert tries again.
+  position balanceBucket(size_type index) {
+    if(bucketCount >= MIN_TREEIFY_BUCKETS) {
+      size_type length = 0;
+      for(Node* node = hashArray[index]; node && length <= TREEIFY_THRESHOLD; node = node->next)
+        ++length;
+      if(length > TREEIFY_THRESHOLD) {
+        try {
+          treeify(index);
+        }
+        catch(...) {
+        }
+      }
+    }
+    return Position{index, hashArray[index]};
+  }
+
+  // puts a node in front of its bucket, buckets have to be allocated already
+  position link(size_type index, Node* node) {
+    node->next = hashArray[index];
+    hashArray[index] = node;
+    markOccupied(index);
+    if(!size) {
+      minimalHash = index;
+      maximalHash = index;
+    }
+    else {
+      if(minimalHash > index)
+        minimalHash = index;
+      if(maximalHash < index)
+        maximalHash = index;
+    }
+
+    ++size;
+    return Position{index, node};
+  }
+
+  // puts a node in front of a tree bin
+  position linkTreeNode(size_type index, TreeNode* node) {
+    node->next = hashArray[index];
+    if(node->next)
+      asTree(node->next)->prev = node;
+    hashArray[index] = node;
+    insertIntoTree(index, node);
+    ++size;
+    return Position{index, node};
+  }
+
+  // builds an entry in front of its bucket, as a tree node in a tree bin
+  template <typename... Args>
+  position linkNew(size_type index, size_type hash, Args&&... args) {
+    if(isTreeBin(index))
+      return linkTreeNode(index, treePool.create(nullptr, hash, std::forward<Args>(args)...));
+    link(index, pool.create(nullptr, hash, std::forward<Args>(args)...));
+    return balanceBucket(index);
+  }
+
+  // copies other bucket by bucket keeping the order of every chain and its tree bins, with no hashing
+  // and no key comparisons outside the trees; the bucket array is reused when the bucket counts match
+  // and nodes freed from the old contents are reused by the pools. Leaves the table empty if a copy throws.
+  void cloneFrom(const Table& other) {
+    if(hashArray)
+      destroyNodes();
+    if(bucketCount != other.bucketCount) {
+      delete [] hashArray;
+      delete [] occupied;
+      hashArray = nullptr;
+      occupied = nullptr;
+      bucketCount = 0;
+      if(other.hashArray) {
+        allocateBuckets(other.bucketCount, hashArray, occupied);
+        bucketCount = other.bucketCount;
+      }
+    }
+
+    try {
+      for(size_type i = other.nextOccupied(0); i < bucketCount; i = other.nextOccupied(i + 1)) {
+        markOccupied(i);
+        bool tree = other.isTreeBin(i);
+        if(tree && !trees)
+          trees = new TreeBin[bucketCount]();
+        Node** tail = &hashArray[i];
+        Node* last = nullptr;
+        for(Node* node = other.hashArray[i]; node; node = node->next) {
+          if(tree) {
+            TreeNode* copy = treePool.create(nullptr, node->hash, node->data);
+            copy->prev = last;
+            *tail = copy;
+            insertIntoTree(i, copy);
+          }
+          else
+            *tail = pool.create(nullptr, node->hash, node->data);
+          last = *tail;
+          tail = &last->next;
+          ++size;
+        }
+      }
+    }
+    catch(...) {
+      clear();
+      throw;
+    }
+    minimalHash = other.minimalHash;
+    maximalHash = other.maximalHash;
+  }
+
+  // a bin shrinking to UNTREEIFY_THRESHOLD goes back to a plain chain, or stays a tree if that fails
+  void eraseFromTree(size_type index, TreeNode* node) {
+    if(node->prev)
+      node->prev->next = node->next;
+    else
+      hashArray[index] = node->next;
+    if(node->next)
+      asTree(node->next)->prev = node->prev;
+    TreeBin& bin = trees[index];
+    bin.tree.erase(node);
+    --bin.size;
+    treePool.destroy(node);
+
+    if(bin.size <= UNTREEIFY_THRESHOLD && !bin.tree.isEmpty()) {
+      try {
+        untreeify(index);
+      }
+      catch(...) {
+      }
+    }
+  }
+
+  void growIfNeeded() {
+    if(size + 1 > bucketCount * maxLoadFactor)
+      rebuild(nextBucketCount(bucketCount * 2));
+  }
+
+  // shrinks once the load factor drops below a quarter of the maximum, leaving room for twice the size
+  void shrinkIfNeeded() {
+    if(bucketCount > MIN_BUCKET_COUNT && size < bucketCount * maxLoadFactor / 4) {
+      size_type target = nextBucketCount(std::max(bucketsNeededFor(size * 2), MIN_BUCKET_COUNT));
+      if(target < bucketCount)
+        rebuild(target);
+    }
+  }
+
+public:
+  // buckets are allocated on the first insert, so empty tables own no memory
+  Table() : Table(Hasher(), KeyEqual()) {}
+
+  Table(const Hasher& hash, const KeyEqual& equal) :
+    hashArray(nullptr), occupied(nullptr), trees(nullptr), bucketCount(0), minimalHash(0), maximalHash(0), size(0),
+    maxLoadFactor(1.0f), hasher(hash), keyEqual(equal) {}
+
+  Table(const Table& other) : Table(other.hasher, other.keyEqual) {
+    maxLoadFactor = other.maxLoadFactor;
+    cloneFrom(other);
+  }
+
+  Table(Table&& other) noexcept(nothrow_move::value) : Table(other.hasher, other.keyEqual) {
+    swap(other);
+  }
+
+  ~Table() {
+    if(hashArray)
+      destroyAll();
+  }
+
+  // reuses this table's buckets and nodes where it can, see cloneFrom
+  Table& operator=(const Table& other) {
+    if(this == &other)
+      return *this;
+
+    hasher = other.hasher;
+    keyEqual = other.keyEqual;
+    maxLoadFactor = other.maxLoadFactor;
+    cloneFrom(other);
+    return *this;
+  }
+
+  // the source is left empty and without buckets, whatever this table held is freed right away
+  Table& operator=(Table&& other) noexcept(nothrow_move::value) {
+    if(this == &other)
+      return *this;
+
+    Table toDel(std::move(*this));
+    swap(other);
+    return *this;
+  }
+
+  void swap(Table& other) {
+    std::swap(hashArray, other.hashArray);
+    std::swap(occupied, other.occupied);
+    std::swap(trees, other.trees);
+    pool.swap(other.pool);
+    treePool.swap(other.treePool);
+    std::swap(bucketCount, other.bucketCount);
+    std::swap(minimalHash, other.minimalHash);
+    std::swap(maximalHash, other.maximalHash);
+    std::swap(size, other.size);
+    std::swap(maxLoadFactor, other.maxLoadFactor);
+    std::swap(hasher, other.hasher);
+    std::swap(keyEqual, other.keyEqual);
+    counters.swap(other.counters);
+  }
+
+  const Hasher& getHasher() const {
+    return hasher;
+  }
+
+  const KeyEqual& getKeyEqual() const {
+    return keyEqual;
+  }
+
+  size_type getSize() const {
+    return size;
+  }
+
+  size_type getBucketCount() const {
+    return bucketCount;
+  }
+
+  float getMaxLoadFactor() const {
+    return maxLoadFactor;
+  }
+
+  void setMaxLoadFactor(float factor) {
+    maxLoadFactor = factor;
+    if(size > bucketCount * maxLoadFactor)
+      rehash(0);
+  }
+
+  // sets bucket count to at least n, never below what the current size and max load factor require
+  void rehash(size_type n) {
+    if(!hashArray && !n)
+      return;
+    size_type target = nextBucketCount(std::max(std::max(n, bucketsNeededFor(size)), MIN_BUCKET_COUNT));
+    if(target != bucketCount)
+      rebuild(target);
+  }
+
+  // makes room for n elements without further rehashing
+  void reserve(size_type n) {
+    if(!n)
+      return;
+    size_type needed = bucketsNeededFor(n);
+    if(needed > bucketCount)
+      rebuild(nextBucketCount(needed));
+  }
+
+  // destroys all entries and gives every chunk of nodes and the bucket array back
+  void clear() {
+    if(hashArray)
+      destroyAll();
+    hashArray = nullptr;
+    occupied = nullptr;
+    bucketCount = minimalHash = maximalHash = size = 0;
+  }
+
+  position first() const {
+    if(!size)
+      return end();
+    return Position{minimalHash, hashArray[minimalHash]};
+  }
+
+  position end() const {
+    return Position{bucketCount, nullptr};
+  }
+
+  position next(position pos) const {
+    if(pos.node->next)
+      return Position{pos.index, pos.node->next};
+    if(pos.index == maximalHash)
+      return end();
+
+    pos.index = nextOccupied(pos.index + 1);
+    return Position{pos.index, hashArray[pos.index]};
+  }
+
+  // pos must not be the first position
+  position prev(position pos) const {
+    if(!pos.node)
+      pos.index = maximalHash;
+    else if(hashArray[pos.index] != pos.node) {
+      if(isTreeBin(pos.index))
+        return Position{pos.index, asTree(pos.node)->prev};
+      Node* node = hashArray[pos.index];
+      while(node->next != pos.node)
+        node = node->next;
+      return Position{pos.index, node};
+    }
+    else
+      pos.index = prevOccupied(pos.index);
+
+    Node* node = hashArray[pos.index];
+    while(node->next)
+      node = node->next;
+    return Position{pos.index, node};
+  }
+
+  value_type& at(position pos) const {
+    return pos.node->data;
+  }
+
+  position find(const key_type& key) const {
+    if(!hashArray) {
+      counters.record(0, false);
+      return end();
+    }
+    return findHashed(key, hasher(key));
+  }
+
+  // hash has to come from getHasher(), lets callers hash a key once for several lookups
+  position findHashed(const key_type& key, size_type hash) const {
+    if(!hashArray) {
+      counters.record(0, false);
+      return end();
+    }
+    size_type index = bucketFor(hash);
+    size_type probes = 0;
+    Node* node = findInBucket(index, hash, key, probes);
+    counters.record(probes, node != nullptr);
+    return node ? Position{index, node} : end();
+  }
+
+  // a chain is a bucket, probes count the nodes compared; walks every bucket
+  HashMapStats getStats() const {
+    HashMapStats stats;
+    stats.size = size;
+    stats.bucketCount = bucketCount;
+    stats.loadFactor = bucketCount ? static_cast<float>(size) / bucketCount : 0.0f;
+    stats.chainLengths.assign(1, 0);
+    for(size_type i = nextOccupied(0); i < bucketCount; i = nextOccupied(i + 1)) {
+      ++stats.occupiedBuckets;
+      stats.addChain(isTreeBin(i) ? trees[i].size : chainLength(i));
+    }
+    stats.chainLengths[0] = bucketCount - stats.occupiedBuckets;
+    stats.bytesUsed = sizeof(Table) + pool.getBytesUsed() + treePool.getBytesUsed();
+    if(hashArray)
+      stats.bytesUsed += bucketCount * sizeof(Node*) + wordsFor(bucketCount) * sizeof(std::uint64_t);
+    if(trees)
+      stats.bytesUsed += bucketCount * sizeof(TreeBin);
+    counters.fill(stats);
+    return stats;
+  }
+
+  void resetCounters() {
+    counters.reset();
+  }
+
+  // entry's key must not be present yet
+  position insert(const value_type& entry) {
+    growIfNeeded();
+    size_type hash = hasher(entry.first);
+    return linkNew(bucketFor(hash), hash, entry);
+  }
+
+  // hashes key once and walks its chain once; args build the entry only when key is missing
+  template <typename... Args>
+  std::pair<position, bool> tryEmplace(const key_type& key, Args&&... args) {
+    return tryEmplaceHashed(hasher(key), key, std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  std::pair<position, bool> tryEmplaceHashed(size_type hash, const key_type& key, Args&&... args) {
+    if(hashArray) {
+      size_type index = bucketFor(hash);
+      if(Node* node = findInBucket(index, hash, key))
+        return std::make_pair(Position{index, node}, false);
+    }
+    growIfNeeded();
+    return std::make_pair(linkNew(bucketFor(hash), hash, std::forward<Args>(args)...), true);
+  }
+
+  // the node is built first to learn its key, a duplicate goes straight back to the pool
+  template <typename... Args>
+  std::pair<position, bool> emplace(Args&&... args) {
+    Node* node = pool.create(nullptr, 0, std::forward<Args>(args)...);
+    size_type hash = 0;
+    size_type index = 0;
+    Node* found = nullptr;
+    TreeNode* treeNode = nullptr;
+    // user hashes and key comparisons may throw as well, the node must not leak then
+    try {
+      hash = node->hash = hasher(node->data.first);
+      if(hashArray) {
+        index = bucketFor(hash);
+        found = findInBucket(index, hash, node->data.first);
+      }
+      if(!found) {
+        growIfNeeded();
+        index = bucketFor(hash);
+        // a tree bin takes tree nodes only, the entry moves into one
+        if(isTreeBin(index))
+          treeNode = treePool.create(nullptr, hash, std::move_if_noexcept(node->data));
+      }
+    }
+    catch(...) {
+      pool.destroy(node);
+      throw;
+    }
+    if(found) {
+      pool.destroy(node);
+      return std::make_pair(Position{index, found}, false);
+    }
+    if(treeNode) {
+      pool.destroy(node);
+      return std::make_pair(linkTreeNode(index, treeNode), true);
+    }
+    link(index, node);
+    return std::make_pair(balanceBucket(index), true);
+  }
+
+  // place of the entry at pos in its bucket's list
+  size_type rankInBucket(position pos) const {
+    size_type rank = 0;
+    for(Node* node = hashArray[pos.index]; node != pos.node; node = node->next)
+      ++rank;
+    return rank;
+  }
+
+  Node* nodeAt(size_type hashIndex, size_type rank) const {
+    Node* node = hashArray[hashIndex];
+    while(rank--)
+      node = node->next;
+    return node;
+  }
+
+  // removes the entry without shrinking the table, so the returned position of the entry that
+  // followed it stays valid
+  position eraseAndAdvance(position pos) {
+    position none = end();
+    return eraseAndAdvance(pos, none);
+  }
+
+  // as above; tracked, a position behind pos, is kept on its entry too
+  position eraseAndAdvance(position pos, position& tracked) {
+    size_type hashIndex = pos.index;
+    position following = next(pos);
+    if(isTreeBin(hashIndex)) {
+      // a bin going back to a chain gets new nodes, positions into it are found again by place
+      bool rebuilt = trees[hashIndex].size <= UNTREEIFY_THRESHOLD + 1;
+      bool tracking = rebuilt && tracked.node && tracked.index == hashIndex;
+      size_type rank = rebuilt ? rankInBucket(pos) : 0;
+      size_type trackedRank = tracking ? rankInBucket(tracked) : 0;
+      eraseFromTree(hashIndex, asTree(pos.node));
+      if(rebuilt && !isTreeBin(hashIndex)) {
+        if(following.index == hashIndex)
+          following.node = nodeAt(hashIndex, rank);
+        if(tracking)
+          tracked.node = nodeAt(hashIndex, trackedRank > rank ? trackedRank - 1 : trackedRank);
+      }
+    }
+    else {
+      Node** link = &hashArray[hashIndex];
+      while(*link != pos.node)
+        link = &(*link)->next;
+      *link = pos.node->next;
+      pool.destroy(pos.node);
+    }
+    --size;
+
+    if(!hashArray[hashIndex]) {
+      markEmpty(hashIndex);
+      if(size && minimalHash == hashIndex)
+        minimalHash = nextOccupied(hashIndex);
+      if(size && maximalHash == hashIndex)
+        maximalHash = prevOccupied(hashIndex);
+    }
+    return following;
+  }
+
+  // the entry is gone before the table shrinks, so a shrink that fails is skipped rather than
+  // reported; the table keeps its buckets and erase does not throw
+  void erase(position pos) {
+    eraseAndAdvance(pos);
+    try {
+      shrinkIfNeeded();
+    }
+    catch(...) {
+    }
+  }
+};
+
+template <typename Value, typename Hasher, typename KeyEqual>
+constexpr typename ChainedStorage::Table<Value, Hasher, KeyEqual>::size_type
+  ChainedStorage::Table<Value, Hasher, KeyEqual>::MIN_BUCKET_COUNT;
+
+template <typename Value, typename Hasher, typename KeyEqual>
+constexpr typename ChainedStorage::Table<Value, Hasher, KeyEqual>::size_type
+  ChainedStorage::Table<Value, Hasher, KeyEqual>::WORD_BITS;
+
+template <typename Value, typename Hasher, typename KeyEqual>
+constexpr typename ChainedStorage::Table<Value, Hasher, KeyEqual>::size_type
+  ChainedStorage::Table<Value, Hasher, KeyEqual>::TREEIFY_THRESHOLD;
+
+template <typename Value, typename Hasher, typename KeyEqual>
+constexpr typename ChainedStorage::Table<Value, Hasher, KeyEqual>::size_type
+  ChainedStorage::Table<Value, Hasher, KeyEqual>::UNTREEIFY_THRESHOLD;
+
+template <typename Value, typename Hasher, typename KeyEqual>
+constexpr typename ChainedStorage::Table<Value, Hasher, KeyEqual>::size_type
+  ChainedStorage::Table<Value, Hasher, KeyEqual>::MIN_TREEIFY_BUCKETS;
+
+}
+
+#endif /* AISDI_MAPS_CHAINEDSTORAGE_H */
@@ -0,0 +1,235 @@
+#ifndef AISDI_MAPS_CONCURRENTHASHMAP_H
+#define AISDI_MAPS_CONCURRENTHASHMAP_H
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include "ChainedStorage.h"
+#include "HashMixing.h"
+#include "RobinHoodStorage.h"
+#include "SwissStorage.h"
+
+namespace aisdi
+{
+
+// Thread-safe hash map split into a power-of-two number of shards, each one a storage table of its
+// own (see HashMap.h) behind its own reader/writer lock. A key is hashed once; the high bits of the
+// mixed hash pick the shard and the low bits index the table inside it, so threads working on
+// different shards never touch the same lock. Values are handed out by copy only: a reference
+// into a shard would outlive the lock protecting it.
+template <typename KeyType, typename ValueType,
+          typename Hash = std::hash<KeyType>, typename KeyEqual = std::equal_to<KeyType>,
+          typename Storage = ChainedStorage>
+class ConcurrentHashMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+
+  static constexpr size_type DEFAULT_SHARD_COUNT = 64;
+
+protected:
+  using mixed_hasher = MixedHash<key_type, Hash>;
+  using table_type = typename Storage::template Table<value_type, mixed_hasher, KeyEqual>;
+  using ReadLock = std::shared_lock<std::shared_timed_mutex>;
+  using WriteLock = std::unique_lock<std::shared_timed_mutex>;
+
+  static constexpr size_type CACHE_LINE = 64;
+
+  // The array is only aligned for the mutex, so a full line of padding on either side is what keeps
+  // each shard's lock and table off the lines of its neighbours and of the heap blocks around it.
+  struct Shard
+  {
+    char paddingBefore[CACHE_LINE];
+    mutable std::shared_timed_mutex mutex;
+    table_type table;
+    char paddingAfter[CACHE_LINE];
+  };
+
+  std::unique_ptr<Shard[]> shards;
+  size_type shardCount;
+  unsigned shardShift;
+  mixed_hasher mixedHash;
+
+  Shard& shardFor(size_type hash) const {
+    // shifted in two steps, so that a single shard does not need a shift by the full word width
+    return shards[hash >> 1 >> shardShift];
+  }
+
+public:
+  // requestedShards is rounded up to a power of two
+  explicit ConcurrentHashMap(size_type requestedShards = DEFAULT_SHARD_COUNT,
+                             const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual()) :
+    shardCount(1), shardShift(std::numeric_limits<size_type>::digits - 1), mixedHash(hash) {
+    if(!requestedShards)
+      throw std::invalid_argument("Concurrent hash map needs at least one shard");
+    while(shardCount < requestedShards) {
+      shardCount *= 2;
+      --shardShift;
+    }
+    shards.reset(new Shard[shardCount]);
+    for(size_type i = 0; i < shardCount; ++i)
+      shards[i].table = table_type(mixedHash, equal);
+  }
+
+  ConcurrentHashMap(const ConcurrentHashMap&) = delete;
+  ConcurrentHashMap& operator=(const ConcurrentHashMap&) = delete;
+
+  size_type getShardCount() const {
+    return shardCount;
+  }
+
+  hasher getHasher() const {
+    return mixedHash.getHash();
+  }
+
+  // copies the value of key into result; result is left alone when key is missing
+  bool find(const key_type& key, mapped_type& result) const {
+    size_type hash = mixedHash(key);
+    const Shard& shard = shardFor(hash);
+    ReadLock lock(shard.mutex);
+    auto pos = shard.table.findHashed(key, hash);
+    if(pos == shard.table.end())
+      return false;
+    result = shard.table.at(pos).second;
+    return true;
+  }
+
+  bool contains(const key_type& key) const {
+    size_type hash = mixedHash(key);
+    const Shard& shard = shardFor(hash);
+    ReadLock lock(shard.mutex);
+    return shard.table.findHashed(key, hash) != shard.table.end();
+  }
+
+  mapped_type valueOf(const key_type& key) const {
+    size_type hash = mixedHash(key);
+    const Shard& shard = shardFor(hash);
+    ReadLock lock(shard.mutex);
+    auto pos = shard.table.findHashed(key, hash);
+    if(pos == shard.table.end())
+      throw std::out_of_range("valueOf element that is not in concurrent hash map");
+    return shard.table.at(pos).second;
+  }
+
+  // returns true when a new entry was added, false when an existing value was overwritten
+  template <typename M>
+  bool insert_or_assign(const key_type& key, M&& obj) {
+    size_type hash = mixedHash(key);
+    Shard& shard = shardFor(hash);
+    WriteLock lock(shard.mutex);
+    auto result = shard.table.tryEmplaceHashed(hash, key, key, std::forward<M>(obj));
+    if(!result.second)
+      shard.table.at(result.first).second = std::forward<M>(obj);
+    return result.second;
+  }
+
+  // args are left untouched and false is returned when key is already present
+  template <typename... Args>
+  bool try_emplace(const key_type& key, Args&&... args) {
+    size_type hash = mixedHash(key);
+    Shard& shard = shardFor(hash);
+    WriteLock lock(shard.mutex);
+    return shard.table.tryEmplaceHashed(hash, key, std::piecewise_construct, std::forward_as_tuple(key),
+                                        std::forward_as_tuple(std::forward<Args>(args)...)).second;
+  }
+
+  // a missing key is not an error here, another thread may have removed it a moment ago
+  bool remove(const key_type& key) {
+    size_type hash = mixedHash(key);
+    Shard& shard = shardFor(hash);
+    WriteLock lock(shard.mutex);
+    auto pos = shard.table.findHashed(key, hash);
+    if(pos == shard.table.end())
+      return false;
+    shard.table.erase(pos);
+    return true;
+  }
+
+  // Read-modify-write of one entry under its shard's exclusive lock. f(value, present) gets the
+  // stored value, or a value-initialised one when key is missing, and returns whether the entry
+  // should stay in the map. Returns that same decision. f must not call back into this map.
+  template <typename F>
+  bool compute(const key_type& key, F&& f) {
+    size_type hash = mixedHash(key);
+    Shard& shard = shardFor(hash);
+    WriteLock lock(shard.mutex);
+    auto result = shard.table.tryEmplaceHashed(hash, key, std::piecewise_construct, std::forward_as_tuple(key),
+                                               std::forward_as_tuple());
+    bool keep;
+    try {
+      keep = f(shard.table.at(result.first).second, !result.second);
+    }
+    catch(...) {
+      if(result.second)
+        shard.table.erase(result.first);
+      throw;
+    }
+    if(!keep)
+      shard.table.erase(result.first);
+    return keep;
+  }
+
+  // shards are counted one after another, so the result is exact only without concurrent writers
+  size_type getSize() const {
+    size_type result = 0;
+    for(size_type i = 0; i < shardCount; ++i) {
+      ReadLock lock(shards[i].mutex);
+      result += shards[i].table.getSize();
+    }
+    return result;
+  }
+
+  bool isEmpty() const {
+    return !getSize();
+  }
+
+  // makes room for n elements spread evenly over the shards
+  void reserve(size_type n) {
+    for(size_type i = 0; i < shardCount; ++i) {
+      WriteLock lock(shards[i].mutex);
+      shards[i].table.reserve((n + shardCount - 1) / shardCount);
+    }
+  }
+
+  void clear() {
+    for(size_type i = 0; i < shardCount; ++i) {
+      WriteLock lock(shards[i].mutex);
+      shards[i].table.clear();
+    }
+  }
+
+  // calls f(key, value) for every entry, holding one shard's shared lock at a time
+  template <typename F>
+  void forEach(F&& f) const {
+    for(size_type i = 0; i < shardCount; ++i) {
+      ReadLock lock(shards[i].mutex);
+      const table_type& table = shards[i].table;
+      for(auto pos = table.first(); pos != table.end(); pos = table.next(pos))
+        f(table.at(pos).first, static_cast<const mapped_type&>(table.at(pos).second));
+    }
+  }
+};
+
+template <typename KeyType, typename ValueType, typename Hash, typename KeyEqual, typename Storage>
+constexpr typename ConcurrentHashMap<KeyType, ValueType, Hash, KeyEqual, Storage>::size_type
+  ConcurrentHashMap<KeyType, ValueType, Hash, KeyEqual, Storage>::DEFAULT_SHARD_COUNT;
+
+template <typename KeyType, typename ValueType, typename Hash, typename KeyEqual, typename Storage>
+constexpr typename ConcurrentHashMap<KeyType, ValueType, Hash, KeyEqual, Storage>::size_type
+  ConcurrentHashMap<KeyType, ValueType, Hash, KeyEqual, Storage>::CACHE_LINE;
+
+}
+
+#endif /* AISDI_MAPS_CONCURRENTHASHMAP_H */
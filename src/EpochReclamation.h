@@ -0,0 +1,136 @@
+#ifndef AISDI_MAPS_EPOCHRECLAMATION_H
+#define AISDI_MAPS_EPOCHRECLAMATION_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace aisdi
+{
+
+// Epoch-based reclamation shared by every lock-free reader in the process. A reader pins the global
+// epoch for the duration of one read; memory a writer unlinks while the epoch is e may be freed once
+// the epoch reaches e + 2. The epoch only moves forward when every pinned thread has caught up with
+// it, so by then no reader that could still hold the unlinked pointer is left.
+// There is exactly one domain, instance(): a thread's record is kept in a single thread_local, so a
+// second domain would share it and pin or release the first one's epoch.
+class EpochDomain
+{
+  EpochDomain() : globalEpoch(1), records(nullptr) {}
+
+protected:
+  // one per thread, reused after the thread exits; never freed while the domain lives
+  struct Record
+  {
+    std::atomic<std::uint64_t> epoch;  // 0 while the owner is not pinned
+    std::atomic<bool> inUse;
+    unsigned depth;                    // nesting of guards, touched by the owner only
+    Record* next;
+
+    Record() : epoch(0), inUse(true), depth(0), next(nullptr) {}
+  };
+
+  struct LocalRecord
+  {
+    Record* record = nullptr;
+
+    ~LocalRecord() {
+      if(record)
+        record->inUse.store(false, std::memory_order_release);
+    }
+  };
+
+  std::atomic<std::uint64_t> globalEpoch;
+  std::atomic<Record*> records;
+
+  Record* acquireRecord() {
+    for(Record* record = records.load(std::memory_order_acquire); record; record = record->next) {
+      bool expected = false;
+      if(!record->inUse.load(std::memory_order_relaxed) &&
+         record->inUse.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+        return record;
+    }
+
+    Record* record = new Record;
+    Record* head = records.load(std::memory_order_relaxed);
+    do
+      record->next = head;
+    while(!records.compare_exchange_weak(head, record, std::memory_order_release, std::memory_order_relaxed));
+    return record;
+  }
+
+  Record& localRecord() {
+    static thread_local LocalRecord local;
+    if(!local.record)
+      local.record = acquireRecord();
+    return *local.record;
+  }
+
+public:
+  static EpochDomain& instance() {
+    static EpochDomain domain;
+    return domain;
+  }
+
+  EpochDomain(const EpochDomain&) = delete;
+  EpochDomain& operator=(const EpochDomain&) = delete;
+
+  ~EpochDomain() {
+    Record* record = records.load(std::memory_order_relaxed);
+    while(record) {
+      Record* next = record->next;
+      delete record;
+      record = next;
+    }
+  }
+
+  // Pins the current epoch for the lifetime of the guard; nested guards pin only once. Costs two
+  // stores to the thread's own record and a fence, no shared cache line is written.
+  class Guard
+  {
+    Record& record;
+
+  public:
+    Guard() : record(instance().localRecord()) {
+      if(record.depth++ == 0) {
+        record.epoch.store(instance().globalEpoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+        // pairs with the fence in tryAdvance: either the scan there sees this pin, or every load
+        // the reader makes after it sees the writer's unlink and cannot reach the retired memory
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+      }
+    }
+
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+    ~Guard() {
+      if(--record.depth == 0)
+        record.epoch.store(0, std::memory_order_release);
+    }
+  };
+
+  // the epoch to tag memory with right after unlinking it
+  std::uint64_t getEpoch() const {
+    return globalEpoch.load(std::memory_order_seq_cst);
+  }
+
+  // moves the epoch one step forward unless some thread is still pinned to an older one,
+  // returns the epoch in force afterwards
+  std::uint64_t tryAdvance() {
+    // pairs with the fence in Guard(): orders the caller's earlier unlinking stores before the
+    // scan of the pins below
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::uint64_t current = globalEpoch.load(std::memory_order_seq_cst);
+    for(Record* record = records.load(std::memory_order_acquire); record; record = record->next) {
+      std::uint64_t pinned = record->epoch.load(std::memory_order_seq_cst);
+      if(pinned && pinned != current)
+        return current;
+    }
+    if(globalEpoch.compare_exchange_strong(current, current + 1, std::memory_order_seq_cst))
+      ++current;
+    return current;
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_EPOCHRECLAMATION_H */
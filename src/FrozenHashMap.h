@@ -0,0 +1,272 @@
+#ifndef AISDI_MAPS_FROZENHASHMAP_H
+#define AISDI_MAPS_FROZENHASHMAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "HashMixing.h"
+
+namespace aisdi
+{
+
+// Immutable map over a minimal perfect hash, built by HashMap::freeze. Keys are split into
+// buckets of about AVERAGE_BUCKET_SIZE; every bucket gets a pilot, a number picked at build time
+// so that hashing the keys of the bucket together with it sends each one to a slot no other key
+// uses (PTHash's search). The slots run a little past the entry count, one spare per SLACK
+// entries, which keeps the search for the last buckets short; keys sent past the end are remapped
+// into the holes left among the entries. A lookup hashes the key once, reads one pilot and checks
+// one entry; the pilots add 32 bits per bucket on top of the dense entry array.
+// Building has to tell every pair of keys apart by their hashes, so two keys with the same
+// full hash cannot be frozen.
+template <typename KeyType, typename ValueType,
+          typename Hash = std::hash<KeyType>, typename KeyEqual = std::equal_to<KeyType>>
+class FrozenHashMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using const_reference = const value_type&;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+  using const_iterator = typename std::vector<value_type>::const_iterator;
+  using iterator = const_iterator;
+
+  static constexpr size_type AVERAGE_BUCKET_SIZE = 4;
+  static constexpr size_type SLACK = 64;
+
+protected:
+  using Pilot = std::uint32_t;
+
+  std::vector<value_type> entries;
+  std::vector<Pilot> pilots;
+  size_type denseBuckets;
+  // entry index of every slot at or past entries.size()
+  std::vector<size_type> remap;
+  MixedHash<key_type, Hash> mixedHash;
+  KeyEqual keyEqual;
+
+  // maps x onto [0, n) by its high bits, with no division where 128-bit products are available
+  static size_type reduce(std::uint64_t x, size_type n) {
+#if defined(__SIZEOF_INT128__)
+    __extension__ using uint128 = unsigned __int128;
+    return static_cast<size_type>((static_cast<uint128>(x) * n) >> 64);
+#else
+    return static_cast<size_type>(x % n);
+#endif
+  }
+
+  // PTHash's skew: 60% of the keys share the first 30% of the buckets, so that the buckets placed
+  // first are big and the ones placed last small. The hash is mixed once more, as hashes of
+  // sequential keys are too evenly spread to vary the bucket sizes.
+  size_type bucketOf(std::uint64_t hash) const {
+    std::uint64_t mixed = mixHash(hash);
+    std::uint64_t low = mixed & 0xFFFFFFFFull;
+    if(mixed < 0x9999999999999999ull)
+      return static_cast<size_type>((low * denseBuckets) >> 32);
+    return denseBuckets + static_cast<size_type>((low * (pilots.size() - denseBuckets)) >> 32);
+  }
+
+  static size_type slotOf(std::uint64_t hash, Pilot pilot, size_type slotCount) {
+    return reduce(mixHash(hash ^ (pilot * 0x9E3779B97F4A7C15ull)), slotCount);
+  }
+
+  size_type indexOf(std::uint64_t hash) const {
+    size_type slot = slotOf(hash, pilots[bucketOf(hash)], entries.size() + remap.size());
+    return slot < entries.size() ? slot : remap[slot - entries.size()];
+  }
+
+  // Finds a pilot for every bucket, biggest buckets first while most slots are still free; the
+  // many small buckets left at the end find their free slots within a few tries each. Fills
+  // pilots and remap and returns the source entry that goes to every entry index; these point
+  // into [first, last), which has to stay in place until they are copied.
+  template <typename ForwardIt>
+  std::vector<const value_type*> place(ForwardIt first, ForwardIt last, size_type count) {
+    std::vector<std::uint64_t> hashes;
+    std::vector<const value_type*> sources;
+    hashes.reserve(count);
+    sources.reserve(count);
+    for(ForwardIt it = first; it != last; ++it) {
+      hashes.push_back(mixedHash(it->first));
+      sources.push_back(&*it);
+    }
+    count = hashes.size();
+    size_type bucketCount = std::max<size_type>(1, (count + AVERAGE_BUCKET_SIZE - 1) / AVERAGE_BUCKET_SIZE);
+    pilots.assign(bucketCount, 0);
+    denseBuckets = bucketCount * 3 / 10;
+
+    // keys grouped by bucket, each group sorted by hash to catch keys that cannot be told apart
+    std::vector<size_type> starts(bucketCount + 1, 0);
+    for(std::uint64_t hash : hashes)
+      ++starts[bucketOf(hash) + 1];
+    for(size_type i = 0; i < bucketCount; ++i)
+      starts[i + 1] += starts[i];
+    std::vector<size_type> keys(count);
+    std::vector<size_type> next(starts.begin(), starts.end() - 1);
+    for(size_type i = 0; i < count; ++i)
+      keys[next[bucketOf(hashes[i])]++] = i;
+    for(size_type b = 0; b < bucketCount; ++b) {
+      auto byHash = [&hashes](size_type x, size_type y) { return hashes[x] < hashes[y]; };
+      std::sort(keys.begin() + starts[b], keys.begin() + starts[b + 1], byHash);
+      for(size_type i = starts[b] + 1; i < starts[b + 1]; ++i)
+        if(hashes[keys[i]] == hashes[keys[i - 1]])
+          throw std::invalid_argument("Keys with equal hashes cannot be frozen");
+    }
+
+    std::vector<size_type> order(bucketCount);
+    for(size_type b = 0; b < bucketCount; ++b)
+      order[b] = b;
+    std::stable_sort(order.begin(), order.end(), [&starts](size_type x, size_type y) {
+      return starts[x + 1] - starts[x] > starts[y + 1] - starts[y];
+    });
+
+    size_type slotCount = count + count / SLACK;
+    remap.assign(slotCount - count, 0);
+    // the tries only touch a bitmap and the bucket's own hashes, which stay in cache
+    std::vector<bool> taken(slotCount, false);
+    std::vector<const value_type*> bySlot(slotCount, nullptr);
+    std::vector<std::uint64_t> bucket;
+    std::vector<size_type> slots;
+    for(size_type b : order) {
+      size_type begin = starts[b];
+      size_type end = starts[b + 1];
+      if(begin == end)
+        break;
+      bucket.clear();
+      for(size_type i = begin; i < end; ++i)
+        bucket.push_back(hashes[keys[i]]);
+      for(Pilot pilot = 0; ; ++pilot) {
+        slots.clear();
+        for(std::uint64_t hash : bucket) {
+          size_type slot = slotOf(hash, pilot, slotCount);
+          if(taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end())
+            break;
+          slots.push_back(slot);
+        }
+        if(slots.size() == bucket.size()) {
+          pilots[b] = pilot;
+          for(size_type i = begin; i < end; ++i) {
+            taken[slots[i - begin]] = true;
+            bySlot[slots[i - begin]] = sources[keys[i]];
+          }
+          break;
+        }
+        if(pilot == std::numeric_limits<Pilot>::max())
+          throw std::length_error("No pilot found for a bucket of the frozen hash map");
+      }
+    }
+
+    // every entry past the end moves into a hole, there are as many holes as such entries
+    size_type hole = 0;
+    for(size_type slot = count; slot < slotCount; ++slot) {
+      if(!bySlot[slot])
+        continue;
+      while(bySlot[hole])
+        ++hole;
+      remap[slot - count] = hole;
+      bySlot[hole] = bySlot[slot];
+    }
+    bySlot.resize(count);
+    return bySlot;
+  }
+
+public:
+  FrozenHashMap() : pilots(1, 0), denseBuckets(0) {}
+
+  // Freezes count entries of [first, last); hash has to be the hasher of the source map, so its
+  // seed carries over. Every key has to be distinct. The range is read twice, so it has to be a
+  // forward range over entries that stay where they are, such as the entries of a map.
+  template <typename ForwardIt>
+  FrozenHashMap(ForwardIt first, ForwardIt last, size_type count, const MixedHash<key_type, Hash>& hash,
+                const KeyEqual& equal = KeyEqual()) :
+    denseBuckets(0), mixedHash(hash), keyEqual(equal) {
+    std::vector<const value_type*> bySlot = place(first, last, count);
+    entries.reserve(bySlot.size());
+    for(const value_type* source : bySlot)
+      entries.push_back(*source);
+  }
+
+  bool isEmpty() const {
+    return entries.empty();
+  }
+
+  size_type getSize() const {
+    return entries.size();
+  }
+
+  // buckets that carry a pilot, about one per AVERAGE_BUCKET_SIZE entries
+  size_type getBucketCount() const {
+    return pilots.size();
+  }
+
+  // heap memory held by the map plus the map itself, as HashMapStats::bytesUsed counts it
+  size_type getBytesUsed() const {
+    return sizeof(*this) + entries.capacity() * sizeof(value_type) + pilots.capacity() * sizeof(Pilot)
+           + remap.capacity() * sizeof(size_type);
+  }
+
+  hasher getHasher() const {
+    return mixedHash.getHash();
+  }
+
+  size_type getHashSeed() const {
+    return mixedHash.getSeed();
+  }
+
+  // one pilot, one slot and one key comparison, whether key is present or not
+  const_iterator find(const key_type& key) const {
+    if(entries.empty())
+      return end();
+    size_type index = indexOf(mixedHash(key));
+    if(!keyEqual(key, entries[index].first))
+      return end();
+    return entries.begin() + static_cast<std::ptrdiff_t>(index);
+  }
+
+  bool contains(const key_type& key) const {
+    return find(key) != end();
+  }
+
+  const mapped_type& valueOf(const key_type& key) const {
+    const_iterator it = find(key);
+    if(it == end())
+      throw std::out_of_range("valueOf element that is not in frozen hash map");
+    return it->second;
+  }
+
+  // entries sit in slot order, which is as good as random
+  const_iterator begin() const {
+    return entries.begin();
+  }
+
+  const_iterator end() const {
+    return entries.end();
+  }
+
+  const_iterator cbegin() const {
+    return begin();
+  }
+
+  const_iterator cend() const {
+    return end();
+  }
+};
+
+template <typename KeyType, typename ValueType, typename Hash, typename KeyEqual>
+constexpr typename FrozenHashMap<KeyType, ValueType, Hash, KeyEqual>::size_type
+  FrozenHashMap<KeyType, ValueType, Hash, KeyEqual>::AVERAGE_BUCKET_SIZE;
+
+template <typename KeyType, typename ValueType, typename Hash, typename KeyEqual>
+constexpr typename FrozenHashMap<KeyType, ValueType, Hash, KeyEqual>::size_type
+  FrozenHashMap<KeyType, ValueType, Hash, KeyEqual>::SLACK;
+
+}
+
+#endif /* AISDI_MAPS_FROZENHASHMAP_H */
@@ -1,18 +1,32 @@
 #ifndef AISDI_MAPS_HASHMAP_H
 #define AISDI_MAPS_HASHMAP_H
 
+#include <algorithm>
 #include <cstddef>
+#include <functional>
 #include <initializer_list>
 #include <stdexcept>
+#include <tuple>
+#include <type_traits>
 #include <utility>
-#include <list>
 
-#define H_SIZE 50003
+#include "ChainedStorage.h"
+#include "FrozenHashMap.h"
+#include "HashMapStats.h"
+#include "HashMixing.h"
+#include "RobinHoodStorage.h"
+#include "SmallStorage.h"
+#include "SwissStorage.h"
 
 namespace aisdi
 {
 
-template <typename KeyType, typename ValueType>
+// Storage decides how entries are laid out in memory (see ChainedStorage.h, RobinHoodStorage.h,
+// SwissStorage.h, SmallStorage.h); the map itself only deals with the public API, iterators and error reporting.
+// Hash results go through MixedHash, so every storage can reduce them with a power-of-two mask.
+template <typename KeyType, typename ValueType,
+          typename Hash = std::hash<KeyType>, typename KeyEqual = std::equal_to<KeyType>,
+          typename Storage = ChainedStorage>
 class HashMap
 {
 public:
@@ -22,6 +36,8 @@ public:
   using size_type = std::size_t;
   using reference = value_type&;
   using const_reference = const value_type&;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
 
   class ConstIterator;
   class Iterator;
@@ -30,114 +46,241 @@ public:
 
 
 protected:
-  unsigned minimalHash, maximalHash;
-  std::list<value_type>* hashArray;
-  unsigned size;
-
-  unsigned hashFunction(const key_type key) const {
-    return ((std::hash<key_type>{}(key)) % H_SIZE);
-  }
-
-  		iterator insert(const_reference entry) {
-      unsigned hashIndex = hashFunction(entry.first) ;
-      if(isEmpty()) {
-        minimalHash = hashIndex;
-        maximalHash = hashIndex;
-      }
-      else {
-        if(minimalHash > hashIndex)
-          minimalHash = hashIndex;
-				if(maximalHash < hashIndex)
-					maximalHash = hashIndex;
-      }
-
-      ++size;
-
-      auto it = hashArray[hashIndex].begin();
-      for(; it != hashArray[hashIndex].end(); ++it ) {
-        if(it->first < entry.first)
-          return iterator(this, hashIndex, (hashArray[hashIndex].insert(it, entry)));
-      }
-      return iterator(this, hashIndex, (hashArray[hashIndex].insert(it, entry)));
-		}
-
+  using table_type = typename Storage::template Table<value_type, MixedHash<key_type, Hash>, KeyEqual>;
+  using position = typename table_type::position;
+
+  table_type table;
+
+  // keys between the stages of a batched lookup, see findBlocks
+  static constexpr size_type PREFETCH_DISTANCE = 8;
+
+  std::pair<iterator, bool> makeResult(std::pair<position, bool> result) {
+    return std::make_pair(iterator(this, result.first), result.second);
+  }
+
+  // calls emit(i, position of keys[i]) in order
+  template <typename Emit>
+  void findBlocks(const key_type* keys, size_type n, Emit emit) const {
+    findBlocks(keys, n, emit, typename table_type::prefetches_batches());
+  }
+
+  template <typename Emit>
+  void findBlocks(const key_type* keys, size_type n, Emit emit, std::false_type) const {
+    for(size_type i = 0; i < n; ++i)
+      emit(i, table.find(keys[i]));
+  }
+
+  // A software pipeline over the keys: key i is hashed and prefetched, the storage prefetches what
+  // that leads to PREFETCH_DISTANCE keys later, once the first lines have arrived, and the key is
+  // resolved another PREFETCH_DISTANCE keys after that. The steady state runs without branches.
+  template <typename Emit>
+  void findBlocks(const key_type* keys, size_type n, Emit emit, std::true_type) const {
+    // the hashes of the keys in flight, a power of two so that indices are masked
+    const size_type RING = 4 * PREFETCH_DISTANCE;
+    const size_type LAG = 2 * PREFETCH_DISTANCE;
+    size_type hashes[RING];
+    auto start = [&](size_type i) {
+      hashes[i % RING] = table.getHasher()(keys[i]);
+      table.prefetch(hashes[i % RING]);
+    };
+    auto advance = [&](size_type i) {
+      table.prefetchEntry(hashes[i % RING]);
+    };
+    auto finish = [&](size_type i) {
+      emit(i, table.findHashed(keys[i], hashes[i % RING]));
+    };
+
+    size_type i = 0;
+    for(; i < n && i < LAG; ++i) {
+      start(i);
+      if(i >= PREFETCH_DISTANCE)
+        advance(i - PREFETCH_DISTANCE);
+    }
+    for(; i < n; ++i) {
+      start(i);
+      advance(i - PREFETCH_DISTANCE);
+      finish(i - LAG);
+    }
+    for(; i < n + LAG; ++i) {
+      if(i >= PREFETCH_DISTANCE && i - PREFETCH_DISTANCE < n)
+        advance(i - PREFETCH_DISTANCE);
+      if(i >= LAG)
+        finish(i - LAG);
+    }
+  }
 
 public:
 
-  HashMap() :  minimalHash(0), maximalHash(0), size(0) {
-    hashArray = new std::list<value_type>[H_SIZE];
-  }
+  HashMap() = default;
 
-  HashMap(std::initializer_list<value_type> list) : HashMap() {
+  explicit HashMap(const Hash& hash, const KeyEqual& equal = KeyEqual()) :
+    table(MixedHash<key_type, Hash>(hash), equal) {}
+
+  HashMap(std::initializer_list<value_type> list, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual()) :
+    HashMap(hash, equal) {
+    reserve(list.size());
     for(auto it = list.begin(); it != list.end(); ++it)
       insert(*it);
   }
 
-  HashMap(const HashMap& other) : HashMap() {
-    for(auto it = other.begin(); it != other.end(); ++it)
-      insert(*it);
+  HashMap(const HashMap& other) = default;
+
+  // noexcept for every storage whose table moves cannot throw, so containers of maps move them
+  HashMap(HashMap&& other) noexcept(std::is_nothrow_move_constructible<table_type>::value) = default;
+
+  ~HashMap() = default;
+
+  // copies clone the storage layout as is, without rehashing, and reuse this map's memory where they can
+  HashMap& operator=(const HashMap& other) = default;
+
+  // the source is left empty and without buckets
+  HashMap& operator=(HashMap&& other) noexcept(std::is_nothrow_move_assignable<table_type>::value) = default;
+
+  void swap(HashMap& other) {
+    table.swap(other.table);
   }
 
-  HashMap(HashMap&& other) {
-    size = other.size;
-    minimalHash = other.minimalHash;
-    maximalHash = other.maximalHash;
-    hashArray = other.hashArray;
+  bool isEmpty() const {
+    return !table.getSize();
+  }
 
-    other.size = other.minimalHash = maximalHash = 0;
-    other.hashArray = new std::list<value_type>[H_SIZE];
+  hasher getHasher() const {
+    return table.getHasher().getHash();
   }
 
-  ~HashMap() {
-    delete [] hashArray;
+  key_equal getKeyEqual() const {
+    return table.getKeyEqual();
   }
 
-  HashMap& operator=(const HashMap& other) {
-    if(this == &other)
-      return *this;
+  // 0 unless setHashSeed was called
+  size_type getHashSeed() const {
+    return table.getHasher().getSeed();
+  }
 
-    if(!isEmpty()) {
-      delete [] hashArray;
-      hashArray = new std::list<value_type>[H_SIZE];
-      size = 0;
+  // Moves every entry into a table whose hashes are seeded by seed, e.g. randomHashSeed(), so keys
+  // crafted to collide in another map do not collide in this one; copies keep the seed. Leaves the
+  // map empty if an exception is thrown.
+  void setHashSeed(size_type seed) {
+    table_type seeded(MixedHash<key_type, Hash>(table.getHasher().getHash(), seed), table.getKeyEqual());
+    try {
+      seeded.setMaxLoadFactor(table.getMaxLoadFactor());
+      seeded.reserve(table.getSize());
+      for(position pos = table.first(); pos != table.end(); pos = table.next(pos))
+        seeded.tryEmplace(table.at(pos).first, std::move(table.at(pos)));
     }
-    for(auto it = other.begin(); it != other.end(); ++it)
-      insert(*it);
+    catch(...) {
+      clear();
+      throw;
+    }
+    table.swap(seeded);
+  }
 
-    return *this;
+  size_type getBucketCount() const {
+    return table.getBucketCount();
   }
 
-  HashMap& operator=(HashMap&& other) {
-    if(this == &other)
-      return *this;
+  float getLoadFactor() const {
+    if(!table.getBucketCount())
+      return 0.0f;
+    return static_cast<float>(table.getSize()) / table.getBucketCount();
+  }
 
-    std::list<value_type>* toDel = hashArray;
+  float getMaxLoadFactor() const {
+    return table.getMaxLoadFactor();
+  }
 
-    size = other.size;
+  // layout snapshot taken by walking the whole table, see HashMapStats
+  HashMapStats stats() const {
+    return table.getStats();
+  }
 
-    minimalHash = other.minimalHash;
-    maximalHash = other.maximalHash;
-    hashArray = other.hashArray;
-    other.size = 0;
-    other.hashArray = new std::list<value_type>[H_SIZE];
+  // zeroes the lookup counters of stats(), a no-op without AISDI_HASHMAP_COUNTERS
+  void resetCounters() {
+    table.resetCounters();
+  }
 
-    delete [] toDel;
+  // Copies the entries into an immutable map over a minimal perfect hash, see FrozenHashMap.
+  // Throws std::invalid_argument when two keys share their full hash.
+  FrozenHashMap<key_type, mapped_type, Hash, KeyEqual> freeze() const {
+    return FrozenHashMap<key_type, mapped_type, Hash, KeyEqual>(begin(), end(), getSize(), table.getHasher(),
+                                                                table.getKeyEqual());
+  }
 
-    return *this;
+  // has to be positive; open addressing storages also cap it, RobinHoodStorage at 1 and
+  // SwissStorage at 0.9375, and throw std::invalid_argument above that
+  void setMaxLoadFactor(float factor) {
+    if(!(factor > 0.0f))
+      throw std::invalid_argument("Max load factor has to be positive");
+    table.setMaxLoadFactor(factor);
   }
 
-  bool isEmpty() const {
-    return !size;
+  // sets bucket count to at least n, never below what the current size and max load factor require
+  void rehash(size_type n) {
+    table.rehash(n);
+  }
+
+  // makes room for n elements without further rehashing
+  void reserve(size_type n) {
+    table.reserve(n);
+  }
+
+  // removes every element and releases all memory the map holds
+  void clear() {
+    table.clear();
   }
 
   mapped_type& operator[](const key_type& key) {
-    iterator tmp = find(key);
-    if(tmp != end())
-      return tmp->second;
-    else {
-      iterator it = insert(value_type(key, mapped_type()));
-      return it->second;
-    }
+    return try_emplace(key).first->second;
+  }
+
+  mapped_type& operator[](key_type&& key) {
+    return try_emplace(std::move(key)).first->second;
+  }
+
+  // Insertion looks the key up and places the new entry within one probe of the table. The bool
+  // tells whether an entry was added; if not, the iterator points at the one already present.
+  std::pair<iterator, bool> insert(const value_type& entry) {
+    return makeResult(table.tryEmplace(entry.first, entry));
+  }
+
+  std::pair<iterator, bool> insert(value_type&& entry) {
+    return makeResult(table.tryEmplace(entry.first, std::move(entry)));
+  }
+
+  // builds the entry from args up front, so it is thrown away when its key is already present
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    return makeResult(table.emplace(std::forward<Args>(args)...));
+  }
+
+  // args are left untouched when key is already present
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args) {
+    return makeResult(table.tryEmplace(key, std::piecewise_construct, std::forward_as_tuple(key),
+                                       std::forward_as_tuple(std::forward<Args>(args)...)));
+  }
+
+  // key is moved from only when a new entry is made
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args) {
+    return makeResult(table.tryEmplace(key, std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+                                       std::forward_as_tuple(std::forward<Args>(args)...)));
+  }
+
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& obj) {
+    auto result = table.tryEmplace(key, key, std::forward<M>(obj));
+    if(!result.second)
+      table.at(result.first).second = std::forward<M>(obj);
+    return makeResult(result);
+  }
+
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(key_type&& key, M&& obj) {
+    auto result = table.tryEmplace(key, std::move(key), std::forward<M>(obj));
+    if(!result.second)
+      table.at(result.first).second = std::forward<M>(obj);
+    return makeResult(result);
   }
 
   const mapped_type& valueOf(const key_type& key) const {
@@ -159,25 +302,26 @@ public:
   }
 
   const_iterator find(const key_type& key) const {
-    unsigned index = hashFunction(key);
-    auto it = hashArray[index].begin();
-    while(it != hashArray[index].end()) {
-      if(key == it->first)
-        return const_iterator(this, index, it);
-      ++it;
-    }
-    return cend();
+    return const_iterator(this, table.find(key));
   }
 
   iterator find(const key_type& key) {
-    unsigned index = hashFunction(key);
-    auto it = hashArray[index].begin();
-    while(it != hashArray[index].end()) {
-      if(key == it->first)
-        return iterator(this, index, it);
-      ++it;
-    }
-    return end();
+    return iterator(this, table.find(key));
+  }
+
+  // Looks up n keys in one pass; out[i] is set to find(keys[i]) and out may hold
+  // default-constructed iterators. Open-addressing storages prefetch keys ahead of the one being
+  // resolved, so the cache misses of several keys overlap; chained storage finds them one by one.
+  void find_batch(const key_type* keys, size_type n, const_iterator* out) const {
+    findBlocks(keys, n, [this, out](size_type i, position pos) { out[i] = const_iterator(this, pos); });
+  }
+
+  void find_batch(const key_type* keys, size_type n, iterator* out) {
+    findBlocks(keys, n, [this, out](size_type i, position pos) { out[i] = iterator(this, pos); });
+  }
+
+  void contains_batch(const key_type* keys, size_type n, bool* out) const {
+    findBlocks(keys, n, [this, out](size_type i, position pos) { out[i] = pos != table.end(); });
   }
 
   void remove(const key_type& key) {
@@ -196,44 +340,40 @@ public:
   void remove(const const_iterator& it) {
     if(it == cend())
       throw std::out_of_range("Attempt to remove end iterator");
-    unsigned hashIndex = it.indexIt;
-    hashArray[hashIndex].erase(it.iterIt);
-    --size;
-    if(hashArray[hashIndex].empty() == false)
-      return;
+    table.erase(it.pos);
+  }
 
-    if(isEmpty())
-      return;
+  // Removes the entry at it and returns the iterator to the one that followed it. Unlike remove
+  // this never shrinks the table, so a sweep goes on from the result; rehash(0) gives memory back.
+  iterator erase(const_iterator it) {
+    if(it == cend())
+      throw std::out_of_range("Attempt to erase end iterator");
+    return iterator(this, table.eraseAndAdvance(it.pos));
+  }
 
-    if(minimalHash == hashIndex) {
-        while(hashArray[hashIndex].empty())
-          ++hashIndex;
-        minimalHash = hashIndex;
-    }
-    if(maximalHash == hashIndex) {
-        while(hashArray[hashIndex].empty())
-          --hashIndex;
-        maximalHash = hashIndex;
-    }
+  // Erases in one pass from first up to last. Entries behind an erased one may move
+  // (RobinHoodStorage shifts them back), so the storage keeps last on its entry as it goes.
+  iterator erase(const_iterator first, const_iterator last) {
+    position pos = first.pos;
+    position stop = last.pos;
+    while(pos != stop)
+      pos = table.eraseAndAdvance(pos, stop);
+    return iterator(this, pos);
   }
 
   size_type getSize() const {
-    return size;
+    return table.getSize();
   }
 
   bool operator==(const HashMap& other) const {
 
-    if(size != other.size || minimalHash != other.minimalHash || maximalHash != other.maximalHash)
+    if(getSize() != other.getSize())
       return false;
 
-    if(isEmpty() && other.isEmpty())
-        return true;
-
-    unsigned tmp = minimalHash;
-    while(tmp <= maximalHash) {
-      if(hashArray[tmp] != other.hashArray[tmp])
+    for(auto it = begin(); it != end(); ++it) {
+      const_iterator found = other.find(it->first);
+      if(found == other.end() || found->second != it->second)
         return false;
-      ++tmp;
     }
     return true;
   }
@@ -243,23 +383,19 @@ public:
   }
 
   iterator begin() {
-    if(isEmpty())
-      return end();
-    return iterator(this, minimalHash, hashArray[minimalHash].begin());
+    return iterator(this, table.first());
   }
 
   iterator end() {
-    return iterator(this, maximalHash, hashArray[maximalHash].end());
+    return iterator(this, table.end());
   }
 
   const_iterator cbegin() const {
-    if(isEmpty())
-      return cend();
-    return const_iterator(this, minimalHash, hashArray[minimalHash].begin());
+    return const_iterator(this, table.first());
   }
 
   const_iterator cend() const {
-    return const_iterator(this, maximalHash, hashArray[maximalHash].end());
+    return const_iterator(this, table.end());
   }
 
   const_iterator begin() const {
@@ -271,8 +407,43 @@ public:
   }
 };
 
-template <typename KeyType, typename ValueType>
-class HashMap<KeyType, ValueType>::ConstIterator
+template <typename KeyType, typename ValueType, typename Hash, typename KeyEqual, typename Storage>
+constexpr typename HashMap<KeyType, ValueType, Hash, KeyEqual, Storage>::size_type
+  HashMap<KeyType, ValueType, Hash, KeyEqual, Storage>::PREFETCH_DISTANCE;
+
+template <typename KeyType, typename ValueType,
+          typename Hash = std::hash<KeyType>, typename KeyEqual = std::equal_to<KeyType>>
+using RobinHoodHashMap = HashMap<KeyType, ValueType, Hash, KeyEqual, RobinHoodStorage>;
+
+template <typename KeyType, typename ValueType,
+          typename Hash = std::hash<KeyType>, typename KeyEqual = std::equal_to<KeyType>>
+using SwissHashMap = HashMap<KeyType, ValueType, Hash, KeyEqual, SwissStorage>;
+
+// up to 16 entries inline, chained buckets past that
+template <typename KeyType, typename ValueType,
+          typename Hash = std::hash<KeyType>, typename KeyEqual = std::equal_to<KeyType>>
+using SmallHashMap = HashMap<KeyType, ValueType, Hash, KeyEqual, SmallStorage<>>;
+
+// Erases every entry for which pred(entry) holds in one pass over the map and returns how many
+// there were. Like HashMap::erase it leaves the bucket count as it was.
+template <typename KeyType, typename ValueType, typename Hash, typename KeyEqual, typename Storage,
+          typename Predicate>
+typename HashMap<KeyType, ValueType, Hash, KeyEqual, Storage>::size_type
+erase_if(HashMap<KeyType, ValueType, Hash, KeyEqual, Storage>& map, Predicate pred) {
+  typename HashMap<KeyType, ValueType, Hash, KeyEqual, Storage>::size_type removed = 0;
+  for(auto it = map.begin(); it != map.end();) {
+    if(pred(*it)) {
+      it = map.erase(it);
+      ++removed;
+    }
+    else
+      ++it;
+  }
+  return removed;
+}
+
+template <typename KeyType, typename ValueType, typename Hash, typename KeyEqual, typename Storage>
+class HashMap<KeyType, ValueType, Hash, KeyEqual, Storage>::ConstIterator
 {
 public:
   using reference = typename HashMap::const_reference;
@@ -282,46 +453,32 @@ public:
 
 protected:
     const HashMap *parentMap;
-    unsigned indexIt;
-    typename std::list<value_type>::iterator iterIt;
+    position pos;
 
-    friend void aisdi::HashMap<KeyType, ValueType>::remove(const const_iterator&);
-    friend void aisdi::HashMap<KeyType, ValueType>::remove(const key_type&);
+    friend class HashMap<KeyType, ValueType, Hash, KeyEqual, Storage>;
 
 public:
 
-  explicit ConstIterator(const HashMap* pMap, unsigned int argIndex, typename std::list<value_type>::iterator it) :
-    parentMap(pMap), indexIt(argIndex), iterIt(it) {}
+  // a singular iterator, to be assigned before use; lets arrays of iterators take batch results
+  ConstIterator() : parentMap(nullptr), pos() {}
+
+  explicit ConstIterator(const HashMap* pMap, position argPos) :
+    parentMap(pMap), pos(argPos) {}
 
   ConstIterator(const ConstIterator& other) {
     parentMap = other.parentMap;
-    indexIt = other.indexIt;
-    iterIt = other.iterIt;
+    pos = other.pos;
   }
 
+  ConstIterator& operator=(const ConstIterator& other) = default;
+
   ConstIterator& operator++() {
 
     if(*this == parentMap->cend())
       throw std::out_of_range("Attempt to increment end iterator");
 
-    ++iterIt; //inkrementujemy iterator z listy
-
-    if(iterIt == parentMap->hashArray[indexIt].cend()) { //jezeli teraz iterator wskazuje na koniec listy
-      if(indexIt == parentMap->maximalHash) // jezeli znajdujemy sie w ostatniej liscie w ktorej cokolwiek jest to znaczy ze teraz zwrocimy enda
-        return *this;
-
-      ++indexIt; //przechodzimy do kolejnej listy
-      while(indexIt <= parentMap->maximalHash) { // przechodzimy do kolejnych list az dojdziemy do ostatniej listy w ktorej cos jest albo ponizszy warunek bedzie spelniony
-        if(parentMap->hashArray[indexIt].empty() == false) { //jezeli dana lista nie jest pusta to zatrzymujemy sie w niej
-          iterIt = parentMap->hashArray[indexIt].begin(); //zmieniamy iterator listowy na poczatek listy
-          return *this; // po robocie ;)
-        }
-        ++indexIt; //zwiekszamy index w petli
-      } //while
-    } // if list.end
-
+    pos = parentMap->table.next(pos);
     return *this;
-
   }
 
   ConstIterator operator++(int) {
@@ -334,20 +491,7 @@ public:
     if(*this == parentMap->cbegin())
       throw std::out_of_range("Attempt to decrement begin iterator");
 
-    if(iterIt != parentMap->hashArray[indexIt].begin()) { //jezeli nie wskazuje na poczatek listy
-      --iterIt;
-      return *this;
-    }
-    else { //wskazuje na poczatek listy
-      --indexIt;
-      while(indexIt >= parentMap->minimalHash) {
-        if(parentMap->hashArray[indexIt].empty() == false) {
-          iterIt = --(parentMap->hashArray[indexIt].end()); //iterator listowy wskazuje teraz na element ostatni w liscie
-          return *this;
-        }
-        --indexIt;
-      }
-    }
+    pos = parentMap->table.prev(pos);
     return *this;
   }
 
@@ -360,7 +504,7 @@ public:
   reference operator*() const {
     if(*this == parentMap->end())
       throw std::out_of_range("Attempt to dereference end iterator");
-    return *iterIt;
+    return parentMap->table.at(pos);
   }
 
   pointer operator->() const {
@@ -368,7 +512,7 @@ public:
   }
 
   bool operator==(const ConstIterator& other) const {
-    return iterIt == other.iterIt;
+    return pos == other.pos;
   }
 
   bool operator!=(const ConstIterator& other) const {
@@ -376,14 +520,17 @@ public:
   }
 };
 
-template <typename KeyType, typename ValueType>
-class HashMap<KeyType, ValueType>::Iterator : public HashMap<KeyType, ValueType>::ConstIterator
+template <typename KeyType, typename ValueType, typename Hash, typename KeyEqual, typename Storage>
+class HashMap<KeyType, ValueType, Hash, KeyEqual, Storage>::Iterator
+  : public HashMap<KeyType, ValueType, Hash, KeyEqual, Storage>::ConstIterator
 {
 public:
   using reference = typename HashMap::reference;
   using pointer = typename HashMap::value_type*;
 
-  explicit Iterator(HashMap *parentMap, unsigned int ind, typename std::list<value_type>::iterator it) : ConstIterator(parentMap, ind, it){}
+  Iterator() : ConstIterator() {}
+
+  explicit Iterator(HashMap *parentMap, position pos) : ConstIterator(parentMap, pos){}
 
   Iterator(const ConstIterator& other)
     : ConstIterator(other)
@@ -0,0 +1,123 @@
+#ifndef AISDI_MAPS_HASHMAPSTATS_H
+#define AISDI_MAPS_HASHMAPSTATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifdef AISDI_HASHMAP_COUNTERS
+#  include <atomic>
+#endif
+
+namespace aisdi
+{
+
+// Snapshot of a hash table's layout returned by HashMap::stats(). What a chain is depends on the
+// storage: the entries of one bucket for ChainedStorage, the probes a lookup needs to reach one
+// entry for the open addressing storages. Either way it is how far a lookup walks, so a growing
+// maxChainLength at a steady load factor points at a weak hash.
+struct HashMapStats
+{
+  std::size_t size;
+  std::size_t bucketCount;
+  std::size_t occupiedBuckets;
+  float loadFactor;
+  // chainLengths[n] is the number of chains of length n, up to and including maxChainLength
+  std::vector<std::size_t> chainLengths;
+  std::size_t maxChainLength;
+  // heap memory held by the table plus the table itself, spare pool nodes included
+  std::size_t bytesUsed;
+
+  // lookups through find and its relatives; all zero unless built with AISDI_HASHMAP_COUNTERS
+  std::uint64_t finds;
+  std::uint64_t hits;
+  std::uint64_t misses;
+  std::uint64_t probes;
+
+  HashMapStats() :
+    size(0), bucketCount(0), occupiedBuckets(0), loadFactor(0.0f), maxChainLength(0), bytesUsed(0),
+    finds(0), hits(0), misses(0), probes(0) {}
+
+  double getProbesPerFind() const {
+    return finds ? static_cast<double>(probes) / finds : 0.0;
+  }
+
+  // counts one more chain of the given length
+  void addChain(std::size_t length) {
+    if(length >= chainLengths.size())
+      chainLengths.resize(length + 1);
+    ++chainLengths[length];
+    if(maxChainLength < length)
+      maxChainLength = length;
+  }
+};
+
+#ifdef AISDI_HASHMAP_COUNTERS
+// Lookup counters kept by every table. Relaxed atomics, so concurrent readers sharing a table
+// (ConcurrentHashMap) count correctly; the cost is why they are off by default. A copied table
+// starts counting from zero.
+class FindCounters
+{
+  mutable std::atomic<std::uint64_t> finds;
+  mutable std::atomic<std::uint64_t> hits;
+  mutable std::atomic<std::uint64_t> probes;
+
+public:
+  static constexpr bool enabled = true;
+
+  FindCounters() : finds(0), hits(0), probes(0) {}
+
+  FindCounters(const FindCounters&) : FindCounters() {}
+
+  FindCounters& operator=(const FindCounters&) {
+    return *this;
+  }
+
+  void record(std::size_t probeCount, bool hit) const {
+    finds.fetch_add(1, std::memory_order_relaxed);
+    hits.fetch_add(hit, std::memory_order_relaxed);
+    probes.fetch_add(probeCount, std::memory_order_relaxed);
+  }
+
+  void reset() {
+    finds.store(0, std::memory_order_relaxed);
+    hits.store(0, std::memory_order_relaxed);
+    probes.store(0, std::memory_order_relaxed);
+  }
+
+  void fill(HashMapStats& stats) const {
+    stats.finds = finds.load(std::memory_order_relaxed);
+    stats.hits = hits.load(std::memory_order_relaxed);
+    stats.misses = stats.finds - stats.hits;
+    stats.probes = probes.load(std::memory_order_relaxed);
+  }
+
+  void swap(FindCounters& other) {
+    finds.store(other.finds.exchange(finds.load(std::memory_order_relaxed), std::memory_order_relaxed),
+                std::memory_order_relaxed);
+    hits.store(other.hits.exchange(hits.load(std::memory_order_relaxed), std::memory_order_relaxed),
+               std::memory_order_relaxed);
+    probes.store(other.probes.exchange(probes.load(std::memory_order_relaxed), std::memory_order_relaxed),
+                 std::memory_order_relaxed);
+  }
+};
+#else
+// counting compiled out, the calls vanish once inlined
+class FindCounters
+{
+public:
+  static constexpr bool enabled = false;
+
+  void record(std::size_t, bool) const {}
+
+  void reset() {}
+
+  void fill(HashMapStats&) const {}
+
+  void swap(FindCounters&) {}
+};
+#endif
+
+}
+
+#endif /* AISDI_MAPS_HASHMAPSTATS_H */
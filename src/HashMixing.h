@@ -0,0 +1,83 @@
+#ifndef AISDI_MAPS_HASHMIXING_H
+#define AISDI_MAPS_HASHMIXING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <type_traits>
+
+namespace aisdi
+{
+
+// Finalizer applied on top of the user's hash, so that the low bits alone are good enough to index
+// a power-of-two table (std::hash of an integer is the identity on libstdc++). One 64x64->128 bit
+// multiply folded onto itself where the compiler offers it, murmur3's fmix64 otherwise.
+inline std::uint64_t mixHash(std::uint64_t h) {
+#if defined(__SIZEOF_INT128__)
+  __extension__ using uint128 = unsigned __int128;
+  uint128 product = static_cast<uint128>(h) * 0x9E3779B97F4A7C15ull;
+  return static_cast<std::uint64_t>(product) ^ static_cast<std::uint64_t>(product >> 64);
+#else
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDull;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ull;
+  h ^= h >> 33;
+  return h;
+#endif
+}
+
+template <typename...>
+struct MakeVoid
+{
+  using type = void;
+};
+
+// A hash declaring `using is_avalanching = void;` (wyhash, xxh3 and alike) already spreads its bits
+// well and is used as is.
+template <typename Hash, typename = void>
+struct IsAvalanching : std::false_type {};
+
+template <typename Hash>
+struct IsAvalanching<Hash, typename MakeVoid<typename Hash::is_avalanching>::type> : std::true_type {};
+
+// Draws a fresh seed for MixedHash from std::random_device; never returns 0, which means unseeded.
+inline std::size_t randomHashSeed() {
+  std::random_device device;
+  std::uint64_t seed = (static_cast<std::uint64_t>(device()) << 32) ^ device();
+  return static_cast<std::size_t>(seed | 1);
+}
+
+// The hasher HashMap hands to its storage: the user's Hash followed by mixHash when needed. A non-zero
+// seed is folded in before mixing, so bucket collisions found against one map do not carry over to
+// a map seeded differently; keys whose full user hashes collide still collide in every map.
+template <typename Key, typename Hash>
+class MixedHash
+{
+  Hash hash;
+  std::size_t seed;
+
+public:
+  MixedHash() : hash(), seed(0) {}
+
+  explicit MixedHash(const Hash& h, std::size_t s = 0) : hash(h), seed(s) {}
+
+  std::size_t operator()(const Key& key) const {
+    // a seeded hash is always mixed, xor with the seed alone would keep every low-bit collision
+    if(IsAvalanching<Hash>::value && !seed)
+      return hash(key);
+    return static_cast<std::size_t>(mixHash(hash(key) ^ seed));
+  }
+
+  const Hash& getHash() const {
+    return hash;
+  }
+
+  std::size_t getSeed() const {
+    return seed;
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_HASHMIXING_H */
@@ -0,0 +1,476 @@
+#ifndef AISDI_MAPS_MAPPEDHASHMAP_H
+#define AISDI_MAPS_MAPPEDHASHMAP_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "HashMap.h"
+#include "HashMixing.h"
+
+namespace aisdi
+{
+
+// Checksum of a map image: 64-bit words folded in with mixHash. Bytes may come in pieces of any
+// size, the result only depends on their concatenation.
+class ImageChecksum
+{
+  std::uint64_t state;
+  unsigned char pending[8];
+  std::size_t pendingCount;
+
+  void fold(const unsigned char* word) {
+    std::uint64_t value;
+    std::memcpy(&value, word, sizeof(value));
+    state = mixHash(state ^ value) + 0x9E3779B97F4A7C15ull;
+  }
+
+public:
+  ImageChecksum() : state(0), pending(), pendingCount(0) {}
+
+  void update(const void* data, std::size_t n) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    while(n && pendingCount) {
+      pending[pendingCount++] = *bytes++;
+      --n;
+      if(pendingCount == sizeof(pending)) {
+        fold(pending);
+        pendingCount = 0;
+      }
+    }
+    for(; n >= sizeof(pending); bytes += sizeof(pending), n -= sizeof(pending))
+      fold(bytes);
+    std::memcpy(pending, bytes, n);
+    pendingCount = n;
+  }
+
+  std::uint64_t finish() const {
+    ImageChecksum copy(*this);
+    if(copy.pendingCount) {
+      std::memset(copy.pending + copy.pendingCount, 0, sizeof(pending) - copy.pendingCount);
+      copy.fold(copy.pending);
+    }
+    return mixHash(copy.state ^ pendingCount);
+  }
+};
+
+// Fixed-size header at the start of every image; the bucket table and the entries follow, each
+// aligned to ALIGNMENT. Integers are stored in the byte order of the writer, a reader with the
+// other byte order fails on the magic number.
+struct MappedImageHeader
+{
+  static constexpr std::uint64_t MAGIC = 0x314D485349444941ull;  // "AISDIHM1" read little-endian
+  static constexpr std::uint32_t VERSION = 2;
+  static constexpr std::uint64_t ALIGNMENT = 64;
+
+  std::uint64_t magic;
+  std::uint32_t version;
+  std::uint32_t entrySize;
+  std::uint32_t keySize;
+  std::uint32_t valueSize;
+  std::uint64_t size;
+  std::uint64_t bucketCount;
+  std::uint64_t seed;
+  std::uint64_t bucketsOffset;  // bucketCount + 1 entry indices, bucket i holds [start[i], start[i + 1])
+  std::uint64_t entriesOffset;
+  std::uint64_t fileSize;
+  std::uint64_t checksum;       // of the whole file, read with this field as zero
+
+  static std::uint64_t alignUp(std::uint64_t offset) {
+    return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  }
+};
+
+// Read-only hash map living in a memory-mapped image written by save below. Nothing is copied
+// or parsed on open, entries are used right where the page cache holds them, so processes mapping
+// the same file share its pages. Keys and values have to be trivially copyable, and Hash has to
+// give the same results in the reading process as in the writing one (std::hash of an integer
+// does, std::hash of a pointer does not).
+template <typename KeyType, typename ValueType,
+          typename Hash = std::hash<KeyType>, typename KeyEqual = std::equal_to<KeyType>>
+class MappedHashMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using const_reference = const value_type&;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+  using const_iterator = const value_type*;
+  using iterator = const_iterator;
+
+  static_assert(std::is_trivially_copyable<key_type>::value && std::is_trivially_copyable<mapped_type>::value,
+                "Mapped hash map needs trivially copyable keys and values");
+
+protected:
+  void* address;
+  size_type mappedSize;
+  const std::uint64_t* bucketStarts;
+  const value_type* entries;
+  size_type size;
+  size_type bucketCount;
+  MixedHash<key_type, Hash> mixedHash;
+  KeyEqual keyEqual;
+
+  static std::runtime_error badImage(const std::string& path, const std::string& reason) {
+    return std::runtime_error(path + " is not a usable hash map image: " + reason);
+  }
+
+  // checks the header against this map's types and the file, and optionally every byte after it
+  void validate(const std::string& path, bool verify) const {
+    if(mappedSize < sizeof(MappedImageHeader))
+      throw badImage(path, "file too short");
+    const MappedImageHeader& header = *static_cast<const MappedImageHeader*>(address);
+    if(header.magic != MappedImageHeader::MAGIC)
+      throw badImage(path, "wrong magic number or byte order");
+    if(header.version != MappedImageHeader::VERSION)
+      throw badImage(path, "unsupported format version " + std::to_string(header.version));
+    if(header.entrySize != sizeof(value_type) || header.keySize != sizeof(key_type) ||
+       header.valueSize != sizeof(mapped_type))
+      throw badImage(path, "key or value type does not match");
+    if(header.fileSize != mappedSize)
+      throw badImage(path, "file size does not match, the file may be truncated");
+    // sizes are compared by dividing the room left, so no field of a hostile header can overflow a sum
+    if(!header.bucketCount || (header.bucketCount & (header.bucketCount - 1)) ||
+       header.bucketsOffset % MappedImageHeader::ALIGNMENT || header.entriesOffset % MappedImageHeader::ALIGNMENT ||
+       header.bucketsOffset < sizeof(MappedImageHeader) || header.bucketsOffset > header.fileSize ||
+       header.bucketCount >= (header.fileSize - header.bucketsOffset) / sizeof(std::uint64_t) ||
+       header.entriesOffset < header.bucketsOffset + (header.bucketCount + 1) * sizeof(std::uint64_t) ||
+       header.entriesOffset > header.fileSize ||
+       header.size > (header.fileSize - header.entriesOffset) / sizeof(value_type))
+      throw badImage(path, "inconsistent layout");
+    const std::uint64_t* starts = reinterpret_cast<const std::uint64_t*>(
+      static_cast<const char*>(address) + header.bucketsOffset);
+    if(starts[0] != 0 || starts[header.bucketCount] != header.size)
+      throw badImage(path, "inconsistent layout");
+    if(!verify)
+      return;
+
+    MappedImageHeader unsealed = header;
+    unsealed.checksum = 0;
+    ImageChecksum checksum;
+    checksum.update(&unsealed, sizeof(unsealed));
+    checksum.update(static_cast<const char*>(address) + sizeof(header), header.fileSize - sizeof(header));
+    if(checksum.finish() != header.checksum)
+      throw badImage(path, "checksum mismatch");
+    for(std::uint64_t i = 0; i < header.bucketCount; ++i)
+      if(starts[i] > starts[i + 1])
+        throw badImage(path, "inconsistent layout");
+  }
+
+  // the error in errno, to be built right after the call that failed
+  static std::system_error systemError(const std::string& what) {
+    return std::system_error(errno, std::generic_category(), what);
+  }
+
+  static void writeAll(int fd, const void* data, std::size_t n, const std::string& path) {
+    const char* bytes = static_cast<const char*>(data);
+    while(n) {
+      ssize_t written = ::write(fd, bytes, n);
+      if(written < 0) {
+        if(errno == EINTR)
+          continue;
+        throw systemError("Cannot write " + path);
+      }
+      bytes += written;
+      n -= static_cast<std::size_t>(written);
+    }
+  }
+
+  // makes a rename into the directory of path survive a crash
+  static void syncDirectoryOf(const std::string& path) {
+    std::string::size_type slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if(fd < 0)
+      throw systemError("Cannot open directory " + directory);
+    int result = ::fsync(fd);
+    int error = errno;
+    ::close(fd);
+    if(result != 0)
+      throw std::system_error(error, std::generic_category(), "Cannot sync directory " + directory);
+  }
+
+  void unmap() {
+    if(address)
+      ::munmap(address, mappedSize);
+    address = nullptr;
+  }
+
+public:
+  // Maps the image at path. verify reads the whole file once to check its checksum and bucket
+  // table; without it only the header and the ends of the bucket table are checked, which keeps
+  // opening O(1).
+  explicit MappedHashMap(const std::string& path, bool verify = true, const Hash& hash = Hash(),
+                         const KeyEqual& equal = KeyEqual()) :
+    address(nullptr), mappedSize(0), bucketStarts(nullptr), entries(nullptr), size(0), bucketCount(0),
+    mixedHash(hash), keyEqual(equal) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+      throw std::system_error(errno, std::generic_category(), "Cannot open " + path);
+    struct stat status;
+    if(::fstat(fd, &status) != 0) {
+      int error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(), "Cannot stat " + path);
+    }
+    mappedSize = static_cast<size_type>(status.st_size);
+    if(mappedSize) {
+      address = ::mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+      if(address == MAP_FAILED) {
+        int error = errno;
+        address = nullptr;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), "Cannot map " + path);
+      }
+    }
+    ::close(fd);
+
+    try {
+      validate(path, verify);
+    }
+    catch(...) {
+      unmap();
+      throw;
+    }
+    const MappedImageHeader& header = *static_cast<const MappedImageHeader*>(address);
+    const char* base = static_cast<const char*>(address);
+    bucketStarts = reinterpret_cast<const std::uint64_t*>(base + header.bucketsOffset);
+    entries = reinterpret_cast<const value_type*>(base + header.entriesOffset);
+    size = static_cast<size_type>(header.size);
+    bucketCount = static_cast<size_type>(header.bucketCount);
+    mixedHash = MixedHash<key_type, Hash>(hash, static_cast<std::size_t>(header.seed));
+  }
+
+  MappedHashMap(const MappedHashMap&) = delete;
+  MappedHashMap& operator=(const MappedHashMap&) = delete;
+
+  MappedHashMap(MappedHashMap&& other) :
+    address(other.address), mappedSize(other.mappedSize), bucketStarts(other.bucketStarts),
+    entries(other.entries), size(other.size), bucketCount(other.bucketCount),
+    mixedHash(other.mixedHash), keyEqual(other.keyEqual) {
+    other.address = nullptr;
+    other.bucketStarts = nullptr;
+    other.entries = nullptr;
+    other.size = other.bucketCount = 0;
+  }
+
+  MappedHashMap& operator=(MappedHashMap&& other) {
+    if(this == &other)
+      return *this;
+    unmap();
+    address = other.address;
+    mappedSize = other.mappedSize;
+    bucketStarts = other.bucketStarts;
+    entries = other.entries;
+    size = other.size;
+    bucketCount = other.bucketCount;
+    mixedHash = other.mixedHash;
+    keyEqual = other.keyEqual;
+    other.address = nullptr;
+    other.bucketStarts = nullptr;
+    other.entries = nullptr;
+    other.size = other.bucketCount = 0;
+    return *this;
+  }
+
+  ~MappedHashMap() {
+    unmap();
+  }
+
+  // the image at path, see the constructor for what verify checks
+  static MappedHashMap open(const std::string& path, bool verify = true, const Hash& hash = Hash(),
+                            const KeyEqual& equal = KeyEqual()) {
+    return MappedHashMap(path, verify, hash, equal);
+  }
+
+  // Writes count entries from [first, last) as an image for this map type; hash has to be the
+  // hasher of the source map, its seed goes into the header. The range is read twice and its
+  // entries are written through pointers taken on the way, so it has to be a forward range over
+  // entries that stay where they are. The file is written under a unique name next to path,
+  // synced and renamed over it at the end, so processes that still map an older image keep a valid
+  // one and a crash leaves either the old image or the new one, never a mix.
+  // The image keeps the mode mkstemp gives it, readable and writable by its owner only; callers
+  // that share it with other users change the mode after saving.
+  template <typename ForwardIt>
+  static void write(const std::string& path, ForwardIt first, ForwardIt last, size_type count,
+                    const MixedHash<key_type, Hash>& hash) {
+    std::uint64_t buckets = 1;
+    while(buckets < count)
+      buckets *= 2;
+
+    // counting sort of the entries by bucket, by address, so the entries are copied only once
+    std::vector<std::uint64_t> starts(buckets + 1, 0);
+    std::vector<std::uint64_t> indices;
+    indices.reserve(count);
+    for(ForwardIt it = first; it != last; ++it) {
+      indices.push_back(hash(it->first) & (buckets - 1));
+      ++starts[indices.back() + 1];
+    }
+    if(indices.size() != count)
+      throw std::invalid_argument("Entry count does not match the range to save");
+    for(std::uint64_t i = 0; i < buckets; ++i)
+      starts[i + 1] += starts[i];
+    std::vector<const value_type*> ordered(count);
+    std::vector<std::uint64_t> next(starts.begin(), starts.end() - 1);
+    size_type i = 0;
+    for(ForwardIt it = first; it != last; ++it, ++i)
+      ordered[next[indices[i]]++] = &*it;
+
+    MappedImageHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = MappedImageHeader::MAGIC;
+    header.version = MappedImageHeader::VERSION;
+    header.entrySize = sizeof(value_type);
+    header.keySize = sizeof(key_type);
+    header.valueSize = sizeof(mapped_type);
+    header.size = count;
+    header.bucketCount = buckets;
+    header.seed = hash.getSeed();
+    header.bucketsOffset = MappedImageHeader::alignUp(sizeof(MappedImageHeader));
+    header.entriesOffset = MappedImageHeader::alignUp(header.bucketsOffset + starts.size() * sizeof(std::uint64_t));
+    header.fileSize = header.entriesOffset + count * sizeof(value_type);
+
+    // a file of its own next to path, so concurrent saves to the same path never share one
+    std::string temporary = path + ".XXXXXX";
+    int fd = ::mkstemp(&temporary[0]);
+    if(fd < 0)
+      throw systemError("Cannot create a file next to " + path);
+    try {
+      ImageChecksum checksum;
+      auto emit = [fd, &checksum, &temporary](const void* data, std::size_t n) {
+        writeAll(fd, data, n, temporary);
+        checksum.update(data, n);
+      };
+      const char zeros[MappedImageHeader::ALIGNMENT] = {};
+
+      // the header goes in with a zero checksum now and is rewritten with the real one at the end
+      emit(&header, sizeof(header));
+      emit(zeros, header.bucketsOffset - sizeof(header));
+      emit(starts.data(), starts.size() * sizeof(std::uint64_t));
+      emit(zeros, header.entriesOffset - header.bucketsOffset - starts.size() * sizeof(std::uint64_t));
+
+      // entries are copied into a zeroed buffer, so padding inside value_type is written as zeros
+      const size_type BLOCK_ENTRIES = 4096;
+      std::vector<unsigned char> block(BLOCK_ENTRIES * sizeof(value_type));
+      for(size_type start = 0; start < count; start += BLOCK_ENTRIES) {
+        size_type n = std::min(BLOCK_ENTRIES, count - start);
+        std::fill(block.begin(), block.end(), 0);
+        for(size_type j = 0; j < n; ++j)
+          new (block.data() + j * sizeof(value_type)) value_type(*ordered[start + j]);
+        emit(block.data(), n * sizeof(value_type));
+      }
+
+      header.checksum = checksum.finish();
+      if(::lseek(fd, 0, SEEK_SET) != 0)
+        throw systemError("Cannot write " + temporary);
+      writeAll(fd, &header, sizeof(header), temporary);
+      // the data has to reach the disk before the rename that publishes it
+      if(::fsync(fd) != 0)
+        throw systemError("Cannot write " + temporary);
+    }
+    catch(...) {
+      ::close(fd);
+      ::unlink(temporary.c_str());
+      throw;
+    }
+    if(::close(fd) != 0) {
+      std::system_error error = systemError("Cannot write " + temporary);
+      ::unlink(temporary.c_str());
+      throw error;
+    }
+    if(::rename(temporary.c_str(), path.c_str()) != 0) {
+      std::system_error error = systemError("Cannot replace " + path);
+      ::unlink(temporary.c_str());
+      throw error;
+    }
+    syncDirectoryOf(path);
+  }
+
+  bool isEmpty() const {
+    return !size;
+  }
+
+  size_type getSize() const {
+    return size;
+  }
+
+  size_type getBucketCount() const {
+    return bucketCount;
+  }
+
+  size_type getHashSeed() const {
+    return mixedHash.getSeed();
+  }
+
+  const_iterator find(const key_type& key) const {
+    if(!size)
+      return end();
+    size_type bucket = mixedHash(key) & (bucketCount - 1);
+    // an unverified image may hold any bucket starts, the walk never leaves the entries though
+    std::uint64_t last = std::min<std::uint64_t>(bucketStarts[bucket + 1], size);
+    for(std::uint64_t i = bucketStarts[bucket]; i < last; ++i)
+      if(keyEqual(key, entries[i].first))
+        return entries + i;
+    return end();
+  }
+
+  bool contains(const key_type& key) const {
+    return find(key) != end();
+  }
+
+  const mapped_type& valueOf(const key_type& key) const {
+    const_iterator it = find(key);
+    if(it == end())
+      throw std::out_of_range("valueOf element that is not in mapped hash map");
+    return it->second;
+  }
+
+  // entries are stored bucket by bucket, iteration is a plain walk over them
+  const_iterator begin() const {
+    return entries;
+  }
+
+  const_iterator end() const {
+    return entries + size;
+  }
+
+  const_iterator cbegin() const {
+    return begin();
+  }
+
+  const_iterator cend() const {
+    return end();
+  }
+};
+
+// Writes a versioned, checksummed binary image of map to path, for MappedHashMap::open. Keys and
+// values have to be trivially copyable; the hash seed is saved along with the entries. Lives here
+// rather than in HashMap, so only code that maps images depends on the POSIX headers.
+template <typename KeyType, typename ValueType, typename Hash, typename KeyEqual, typename Storage>
+void save(const HashMap<KeyType, ValueType, Hash, KeyEqual, Storage>& map, const std::string& path) {
+  MappedHashMap<KeyType, ValueType, Hash, KeyEqual>::write(path, map.begin(), map.end(), map.getSize(),
+                                                           MixedHash<KeyType, Hash>(map.getHasher(),
+                                                                                    map.getHashSeed()));
+}
+
+}
+
+#endif /* AISDI_MAPS_MAPPEDHASHMAP_H */
@@ -0,0 +1,150 @@
+#ifndef AISDI_MAPS_NODEPOOL_H
+#define AISDI_MAPS_NODEPOOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace aisdi
+{
+
+// Slab allocator for fixed-size nodes owned by one container. Nodes are carved from chunks that
+// double in size up to MAX_CHUNK_NODES, destroyed nodes go to a free list and are reused first.
+// Memory goes back to the system only in release() or the destructor; objects still alive at
+// that point are not destroyed, that is the owner's job.
+template <typename T>
+class NodePool
+{
+public:
+  using size_type = std::size_t;
+
+  static constexpr size_type MIN_CHUNK_NODES = 16;
+  static constexpr size_type MAX_CHUNK_NODES = 4096;
+
+protected:
+  union Block
+  {
+    Block* next;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+  };
+
+  // the first block of every chunk links to the previous chunk
+  Block* chunks;
+  Block* freeList;
+  Block* carveBegin;
+  Block* carveEnd;
+  size_type nextChunkNodes;
+  size_type chunkCount;
+  size_type capacity;
+
+  Block* allocateBlock() {
+    if(freeList) {
+      Block* block = freeList;
+      freeList = block->next;
+      return block;
+    }
+    if(carveBegin == carveEnd) {
+      Block* chunk = static_cast<Block*>(::operator new(sizeof(Block) * (nextChunkNodes + 1)));
+      chunk->next = chunks;
+      chunks = chunk;
+      ++chunkCount;
+      capacity += nextChunkNodes;
+      carveBegin = chunk + 1;
+      carveEnd = carveBegin + nextChunkNodes;
+      nextChunkNodes = std::min(nextChunkNodes * 2, MAX_CHUNK_NODES);
+    }
+    return carveBegin++;
+  }
+
+  void deallocateBlock(Block* block) {
+    block->next = freeList;
+    freeList = block;
+  }
+
+public:
+  NodePool() :
+    chunks(nullptr), freeList(nullptr), carveBegin(nullptr), carveEnd(nullptr),
+    nextChunkNodes(MIN_CHUNK_NODES), chunkCount(0), capacity(0) {}
+
+  NodePool(const NodePool&) = delete;
+  NodePool& operator=(const NodePool&) = delete;
+
+  ~NodePool() {
+    release();
+  }
+
+  template <typename... Args>
+  T* create(Args&&... args) {
+    T* node = allocate();
+    try {
+      return new (node) T(std::forward<Args>(args)...);
+    }
+    catch(...) {
+      deallocate(node);
+      throw;
+    }
+  }
+
+  void destroy(T* node) {
+    node->~T();
+    deallocate(node);
+  }
+
+  // raw storage for one T, for owners that must have every node of a batch before building any
+  T* allocate() {
+    return reinterpret_cast<T*>(&allocateBlock()->storage);
+  }
+
+  // gives back storage from allocate() holding no live object
+  void deallocate(T* node) {
+    deallocateBlock(reinterpret_cast<Block*>(node));
+  }
+
+  // frees every chunk at once
+  void release() {
+    while(chunks) {
+      Block* chunk = chunks;
+      chunks = chunk->next;
+      ::operator delete(chunk);
+    }
+    freeList = carveBegin = carveEnd = nullptr;
+    nextChunkNodes = MIN_CHUNK_NODES;
+    chunkCount = capacity = 0;
+  }
+
+  size_type getChunkCount() const {
+    return chunkCount;
+  }
+
+  // nodes the chunks have room for, live or not
+  size_type getCapacity() const {
+    return capacity;
+  }
+
+  // every chunk also spends one block on the link to the next
+  size_type getBytesUsed() const {
+    return (capacity + chunkCount) * sizeof(Block);
+  }
+
+  void swap(NodePool& other) {
+    std::swap(chunks, other.chunks);
+    std::swap(freeList, other.freeList);
+    std::swap(carveBegin, other.carveBegin);
+    std::swap(carveEnd, other.carveEnd);
+    std::swap(nextChunkNodes, other.nextChunkNodes);
+    std::swap(chunkCount, other.chunkCount);
+    std::swap(capacity, other.capacity);
+  }
+};
+
+template <typename T>
+constexpr typename NodePool<T>::size_type NodePool<T>::MIN_CHUNK_NODES;
+
+template <typename T>
+constexpr typename NodePool<T>::size_type NodePool<T>::MAX_CHUNK_NODES;
+
+}
+
+#endif /* AISDI_MAPS_NODEPOOL_H */
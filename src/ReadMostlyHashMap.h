@@ -0,0 +1,311 @@
+#ifndef AISDI_MAPS_READMOSTLYHASHMAP_H
+#define AISDI_MAPS_READMOSTLYHASHMAP_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "EpochReclamation.h"
+#include "HashMixing.h"
+
+namespace aisdi
+{
+
+// Chained hash map for workloads dominated by lookups. Readers take no lock and never write to a
+// shared cache line: find walks the chains with acquire loads inside an epoch guard and finishes
+// in a bounded number of steps. Writers are serialised by a mutex and publish every change with a
+// single atomic pointer store; a node is never modified once readers can see it, updates link in
+// a fresh copy instead. Unlinked nodes and replaced bucket arrays are freed through EpochDomain.
+// Growing copies every node, so value_type has to be copy constructible.
+template <typename KeyType, typename ValueType,
+          typename Hash = std::hash<KeyType>, typename KeyEqual = std::equal_to<KeyType>>
+class ReadMostlyHashMap
+{
+public:
+  using key_type = KeyType;
+  using mapped_type = ValueType;
+  using value_type = std::pair<const key_type, mapped_type>;
+  using size_type = std::size_t;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+
+protected:
+  static constexpr size_type MIN_BUCKET_COUNT = 8;
+  static constexpr size_type RECLAIM_THRESHOLD = 64;
+
+  struct Node
+  {
+    std::atomic<Node*> next;
+    std::size_t hash;
+    value_type data;
+
+    template <typename... Args>
+    explicit Node(Node* n, std::size_t h, Args&&... args) : next(n), hash(h), data(std::forward<Args>(args)...) {}
+  };
+
+  struct Buckets
+  {
+    size_type mask;
+    std::unique_ptr<std::atomic<Node*>[]> heads;
+
+    explicit Buckets(size_type count) : mask(count - 1), heads(new std::atomic<Node*>[count]) {
+      for(size_type i = 0; i < count; ++i)
+        heads[i].store(nullptr, std::memory_order_relaxed);
+    }
+  };
+
+  struct Retired
+  {
+    void* pointer;
+    void (*deleter)(void*);
+    std::uint64_t epoch;
+  };
+
+  std::atomic<Buckets*> buckets;
+  std::atomic<size_type> size;
+  mutable std::mutex writerMutex;
+  std::vector<Retired> retired;
+  EpochDomain& domain;
+  MixedHash<key_type, Hash> mixedHash;
+  KeyEqual keyEqual;
+
+  static void deleteNode(void* pointer) {
+    delete static_cast<Node*>(pointer);
+  }
+
+  // frees an unpublished or retired array together with every node still linked in it
+  static void deleteTable(void* pointer) {
+    Buckets* table = static_cast<Buckets*>(pointer);
+    for(size_type i = 0; i <= table->mask; ++i) {
+      Node* node = table->heads[i].load(std::memory_order_relaxed);
+      while(node) {
+        Node* next = node->next.load(std::memory_order_relaxed);
+        delete node;
+        node = next;
+      }
+    }
+    delete table;
+  }
+
+  Node* findNode(const Buckets* table, size_type hash, const key_type& key) const {
+    Node* node = table->heads[hash & table->mask].load(std::memory_order_acquire);
+    for(; node; node = node->next.load(std::memory_order_acquire))
+      if(node->hash == hash && keyEqual(key, node->data.first))
+        return node;
+    return nullptr;
+  }
+
+  // called before anything is unlinked, so the push_back in retire cannot throw and leak it
+  void reserveRetired() {
+    if(retired.size() == retired.capacity())
+      retired.reserve(std::max(retired.size() * 2, RECLAIM_THRESHOLD));
+  }
+
+  // pointer has to be unreachable already and reserveRetired called before it was unlinked;
+  // frees whatever no reader can see anymore
+  void retire(void* pointer, void (*deleter)(void*)) {
+    retired.push_back(Retired{pointer, deleter, domain.getEpoch()});
+    if(retired.size() >= RECLAIM_THRESHOLD)
+      reclaim();
+  }
+
+  void reclaim() {
+    std::uint64_t epoch = domain.tryAdvance();
+    auto freeable = std::partition(retired.begin(), retired.end(),
+                                   [epoch](const Retired& item) { return item.epoch + 2 > epoch; });
+    for(auto it = freeable; it != retired.end(); ++it)
+      it->deleter(it->pointer);
+    retired.erase(freeable, retired.end());
+  }
+
+  // readers may still walk the old chains, so the new array gets copies of every node and the
+  // old array is retired with its nodes; writer lock has to be held
+  Buckets* rebuild(size_type count) {
+    Buckets* old = buckets.load(std::memory_order_relaxed);
+    Buckets* fresh = new Buckets(count);
+    try {
+      for(size_type i = 0; old && i <= old->mask; ++i) {
+        Node* node = old->heads[i].load(std::memory_order_relaxed);
+        for(; node; node = node->next.load(std::memory_order_relaxed)) {
+          std::atomic<Node*>& head = fresh->heads[node->hash & fresh->mask];
+          head.store(new Node(head.load(std::memory_order_relaxed), node->hash, node->data),
+                     std::memory_order_relaxed);
+        }
+      }
+      reserveRetired();
+    }
+    catch(...) {
+      deleteTable(fresh);
+      throw;
+    }
+
+    buckets.store(fresh, std::memory_order_release);
+    if(old)
+      retire(old, &deleteTable);
+    return fresh;
+  }
+
+  static size_type bucketCountFor(size_type elements) {
+    size_type result = MIN_BUCKET_COUNT;
+    while(result < elements)
+      result *= 2;
+    return result;
+  }
+
+public:
+  // buckets are allocated on the first insert, so empty maps own no memory
+  explicit ReadMostlyHashMap(const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual()) :
+    buckets(nullptr), size(0), domain(EpochDomain::instance()), mixedHash(hash), keyEqual(equal) {}
+
+  ReadMostlyHashMap(const ReadMostlyHashMap&) = delete;
+  ReadMostlyHashMap& operator=(const ReadMostlyHashMap&) = delete;
+
+  // no reader may be running by now, so everything is freed right away
+  ~ReadMostlyHashMap() {
+    if(Buckets* table = buckets.load(std::memory_order_relaxed))
+      deleteTable(table);
+    for(const Retired& item : retired)
+      item.deleter(item.pointer);
+  }
+
+  // Calls f(value) on the value of key from inside an epoch guard, without taking any lock. The
+  // reference passed to f must not escape it. Returns false, without calling f, when key is missing.
+  template <typename F>
+  bool read(const key_type& key, F&& f) const {
+    size_type hash = mixedHash(key);
+    EpochDomain::Guard guard;
+    const Buckets* table = buckets.load(std::memory_order_acquire);
+    if(!table)
+      return false;
+    const Node* node = findNode(table, hash, key);
+    if(!node)
+      return false;
+    f(static_cast<const mapped_type&>(node->data.second));
+    return true;
+  }
+
+  // copies the value of key into result; result is left alone when key is missing
+  bool find(const key_type& key, mapped_type& result) const {
+    return read(key, [&result](const mapped_type& value) { result = value; });
+  }
+
+  bool contains(const key_type& key) const {
+    return read(key, [](const mapped_type&) {});
+  }
+
+  mapped_type valueOf(const key_type& key) const {
+    size_type hash = mixedHash(key);
+    EpochDomain::Guard guard;
+    const Buckets* table = buckets.load(std::memory_order_acquire);
+    const Node* node = table ? findNode(table, hash, key) : nullptr;
+    if(!node)
+      throw std::out_of_range("valueOf element that is not in read-mostly hash map");
+    return node->data.second;
+  }
+
+  // returns true when a new entry was added; an existing entry is replaced by a fresh node
+  template <typename M>
+  bool insert_or_assign(const key_type& key, M&& obj) {
+    size_type hash = mixedHash(key);
+    std::lock_guard<std::mutex> lock(writerMutex);
+    Buckets* table = buckets.load(std::memory_order_relaxed);
+    if(table) {
+      std::atomic<Node*>* link = &table->heads[hash & table->mask];
+      for(Node* node = link->load(std::memory_order_relaxed); node; node = link->load(std::memory_order_relaxed)) {
+        if(node->hash == hash && keyEqual(key, node->data.first)) {
+          reserveRetired();
+          Node* fresh = new Node(node->next.load(std::memory_order_relaxed), hash, key, std::forward<M>(obj));
+          link->store(fresh, std::memory_order_release);
+          retire(node, &deleteNode);
+          return false;
+        }
+        link = &node->next;
+      }
+    }
+
+    size_type newSize = size.load(std::memory_order_relaxed) + 1;
+    if(!table || newSize > table->mask + 1)
+      table = rebuild(bucketCountFor(newSize * 2));
+    std::atomic<Node*>& head = table->heads[hash & table->mask];
+    head.store(new Node(head.load(std::memory_order_relaxed), hash, key, std::forward<M>(obj)),
+               std::memory_order_release);
+    size.store(newSize, std::memory_order_relaxed);
+    return true;
+  }
+
+  // a missing key is not an error here, another thread may have removed it a moment ago
+  bool remove(const key_type& key) {
+    size_type hash = mixedHash(key);
+    std::lock_guard<std::mutex> lock(writerMutex);
+    Buckets* table = buckets.load(std::memory_order_relaxed);
+    if(!table)
+      return false;
+
+    std::atomic<Node*>* link = &table->heads[hash & table->mask];
+    for(Node* node = link->load(std::memory_order_relaxed); node; node = link->load(std::memory_order_relaxed)) {
+      if(node->hash == hash && keyEqual(key, node->data.first)) {
+        reserveRetired();
+        link->store(node->next.load(std::memory_order_relaxed), std::memory_order_release);
+        size.store(size.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+        retire(node, &deleteNode);
+        return true;
+      }
+      link = &node->next;
+    }
+    return false;
+  }
+
+  // makes room for n elements without further rehashing
+  void reserve(size_type n) {
+    std::lock_guard<std::mutex> lock(writerMutex);
+    Buckets* table = buckets.load(std::memory_order_relaxed);
+    if(n && (!table || n > table->mask + 1))
+      rebuild(bucketCountFor(n));
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(writerMutex);
+    reserveRetired();
+    Buckets* table = buckets.exchange(nullptr, std::memory_order_release);
+    size.store(0, std::memory_order_relaxed);
+    if(table)
+      retire(table, &deleteTable);
+  }
+
+  size_type getSize() const {
+    return size.load(std::memory_order_relaxed);
+  }
+
+  bool isEmpty() const {
+    return !getSize();
+  }
+
+  hasher getHasher() const {
+    return mixedHash.getHash();
+  }
+
+  // unlinked memory still waiting for readers to move on, mostly for tests
+  size_type getRetiredCount() const {
+    std::lock_guard<std::mutex> lock(writerMutex);
+    return retired.size();
+  }
+};
+
+template <typename KeyType, typename ValueType, typename Hash, typename KeyEqual>
+constexpr typename ReadMostlyHashMap<KeyType, ValueType, Hash, KeyEqual>::size_type
+  ReadMostlyHashMap<KeyType, ValueType, Hash, KeyEqual>::MIN_BUCKET_COUNT;
+
+template <typename KeyType, typename ValueType, typename Hash, typename KeyEqual>
+constexpr typename ReadMostlyHashMap<KeyType, ValueType, Hash, KeyEqual>::size_type
+  ReadMostlyHashMap<KeyType, ValueType, Hash, KeyEqual>::RECLAIM_THRESHOLD;
+
+}
+
+#endif /* AISDI_MAPS_READMOSTLYHASHMAP_H */
@@ -0,0 +1,340 @@
+#ifndef AISDI_MAPS_REDBLACKTREE_H
+#define AISDI_MAPS_REDBLACKTREE_H
+
+#include <cstddef>
+
+namespace aisdi
+{
+
+// Links embedded in every node of an intrusive red-black tree; leaves are null pointers.
+struct RedBlackLinks
+{
+  RedBlackLinks* parent;
+  RedBlackLinks* left;
+  RedBlackLinks* right;
+  // nodes in the subtree rooted here, this one included
+  std::size_t size;
+  bool red;
+};
+
+// Balancing half of a red-black tree: it links, unlinks and rotates nodes owned by someone else and
+// never compares keys. The owner finds the insertion point itself and hands it to insertAt.
+// The first and last nodes are kept at hand, so walks from either end start without a descent,
+// and every node knows the size of its subtree, which owners use to find entries by rank.
+class RedBlackTree
+{
+protected:
+  RedBlackLinks* root;
+  RedBlackLinks* leftmost;
+  RedBlackLinks* rightmost;
+
+  void replaceChild(RedBlackLinks* parent, RedBlackLinks* oldChild, RedBlackLinks* newChild) {
+    if(!parent)
+      root = newChild;
+    else if(parent->left == oldChild)
+      parent->left = newChild;
+    else
+      parent->right = newChild;
+  }
+
+  void rotateLeft(RedBlackLinks* node) {
+    RedBlackLinks* child = node->right;
+    node->right = child->left;
+    if(child->left)
+      child->left->parent = node;
+    child->parent = node->parent;
+    replaceChild(node->parent, node, child);
+    child->left = node;
+    node->parent = child;
+    child->size = node->size;
+    node->size = sizeOf(node->left) + sizeOf(node->right) + 1;
+  }
+
+  void rotateRight(RedBlackLinks* node) {
+    RedBlackLinks* child = node->left;
+    node->left = child->right;
+    if(child->right)
+      child->right->parent = node;
+    child->parent = node->parent;
+    replaceChild(node->parent, node, child);
+    child->right = node;
+    node->parent = child;
+    child->size = node->size;
+    node->size = sizeOf(node->left) + sizeOf(node->right) + 1;
+  }
+
+  // links count nodes, given in order, below parent; nodes at redDepth, the only partly filled
+  // level, are red and every other one black
+  static RedBlackLinks* linkBalanced(RedBlackLinks* const* nodes, std::size_t count, RedBlackLinks* parent,
+                                     std::size_t depth, std::size_t redDepth) {
+    if(!count)
+      return nullptr;
+    std::size_t middle = count / 2;
+    RedBlackLinks* node = nodes[middle];
+    node->parent = parent;
+    node->size = count;
+    node->red = depth == redDepth;
+    node->left = linkBalanced(nodes, middle, node, depth + 1, redDepth);
+    node->right = linkBalanced(nodes + middle + 1, count - middle - 1, node, depth + 1, redDepth);
+    return node;
+  }
+
+  static bool isRed(const RedBlackLinks* node) {
+    return node && node->red;
+  }
+
+  // node replaced a black node and is short of one black on its paths; node may be null
+  void eraseFixup(RedBlackLinks* node, RedBlackLinks* parent) {
+    while(node != root && !isRed(node)) {
+      if(node == parent->left) {
+        RedBlackLinks* sibling = parent->right;
+        if(sibling->red) {
+          sibling->red = false;
+          parent->red = true;
+          rotateLeft(parent);
+          sibling = parent->right;
+        }
+        if(!isRed(sibling->left) && !isRed(sibling->right)) {
+          sibling->red = true;
+          node = parent;
+          parent = node->parent;
+        }
+        else {
+          if(!isRed(sibling->right)) {
+            sibling->left->red = false;
+            sibling->red = true;
+            rotateRight(sibling);
+            sibling = parent->right;
+          }
+          sibling->red = parent->red;
+          parent->red = false;
+          sibling->right->red = false;
+          rotateLeft(parent);
+          node = root;
+        }
+      }
+      else {
+        RedBlackLinks* sibling = parent->left;
+        if(sibling->red) {
+          sibling->red = false;
+          parent->red = true;
+          rotateRight(parent);
+          sibling = parent->left;
+        }
+        if(!isRed(sibling->left) && !isRed(sibling->right)) {
+          sibling->red = true;
+          node = parent;
+          parent = node->parent;
+        }
+        else {
+          if(!isRed(sibling->left)) {
+            sibling->right->red = false;
+            sibling->red = true;
+            rotateLeft(sibling);
+            sibling = parent->left;
+          }
+          sibling->red = parent->red;
+          parent->red = false;
+          sibling->left->red = false;
+          rotateRight(parent);
+          node = root;
+        }
+      }
+    }
+    if(node)
+      node->red = false;
+  }
+
+public:
+  RedBlackTree() : root(nullptr), leftmost(nullptr), rightmost(nullptr) {}
+
+  RedBlackLinks* getRoot() const {
+    return root;
+  }
+
+  // the first node in order, null when empty
+  RedBlackLinks* getLeftmost() const {
+    return leftmost;
+  }
+
+  // the last node in order, null when empty
+  RedBlackLinks* getRightmost() const {
+    return rightmost;
+  }
+
+  bool isEmpty() const {
+    return !root;
+  }
+
+  static std::size_t sizeOf(const RedBlackLinks* node) {
+    return node ? node->size : 0;
+  }
+
+  // forgets every node without touching them
+  void reset() {
+    root = leftmost = rightmost = nullptr;
+  }
+
+  // Replaces the tree with count nodes, given in order, linked into a perfectly balanced shape in
+  // O(n) without looking at a single key. Old nodes are forgotten, so the owner frees them first.
+  void assignBalanced(RedBlackLinks* const* nodes, std::size_t count) {
+    reset();
+    if(!count)
+      return;
+
+    // every level above the one holding node count + 1 is full
+    std::size_t redDepth = 0;
+    while((count + 1) >> (redDepth + 1))
+      ++redDepth;
+    root = linkBalanced(nodes, count, nullptr, 0, redDepth);
+    leftmost = nodes[0];
+    rightmost = nodes[count - 1];
+  }
+
+  // links node as the left or right child of parent, which must have no child on that side yet;
+  // a null parent makes node the root of an empty tree
+  void insertAt(RedBlackLinks* parent, bool asLeft, RedBlackLinks* node) {
+    node->parent = parent;
+    node->left = node->right = nullptr;
+    node->size = 1;
+    node->red = true;
+    for(RedBlackLinks* ancestor = parent; ancestor; ancestor = ancestor->parent)
+      ++ancestor->size;
+    if(!parent)
+      root = leftmost = rightmost = node;
+    else if(asLeft) {
+      parent->left = node;
+      if(parent == leftmost)
+        leftmost = node;
+    }
+    else {
+      parent->right = node;
+      if(parent == rightmost)
+        rightmost = node;
+    }
+
+    while(node != root && node->parent->red) {
+      RedBlackLinks* parentNode = node->parent;
+      RedBlackLinks* grandparent = parentNode->parent;
+      if(parentNode == grandparent->left) {
+        RedBlackLinks* uncle = grandparent->right;
+        if(isRed(uncle)) {
+          parentNode->red = uncle->red = false;
+          grandparent->red = true;
+          node = grandparent;
+          continue;
+        }
+        if(node == parentNode->right) {
+          rotateLeft(parentNode);
+          parentNode = node;
+        }
+        parentNode->red = false;
+        grandparent->red = true;
+        rotateRight(grandparent);
+        break;
+      }
+      else {
+        RedBlackLinks* uncle = grandparent->left;
+        if(isRed(uncle)) {
+          parentNode->red = uncle->red = false;
+          grandparent->red = true;
+          node = grandparent;
+          continue;
+        }
+        if(node == parentNode->left) {
+          rotateRight(parentNode);
+          parentNode = node;
+        }
+        parentNode->red = false;
+        grandparent->red = true;
+        rotateLeft(grandparent);
+        break;
+      }
+    }
+    root->red = false;
+  }
+
+  // unlinks node, which has to be in this tree; the node itself is left alone
+  void erase(RedBlackLinks* node) {
+    RedBlackLinks* child;
+    RedBlackLinks* childParent;
+    bool removedRed = node->red;
+
+    if(node == leftmost)
+      leftmost = next(node);
+    if(node == rightmost)
+      rightmost = prev(node);
+
+    // the node that really leaves its place is node itself or, with two children, its successor
+    RedBlackLinks* removed = node->left && node->right ? minimum(node->right) : node;
+    for(RedBlackLinks* ancestor = removed->parent; ancestor; ancestor = ancestor->parent)
+      --ancestor->size;
+
+    if(!node->left || !node->right) {
+      child = node->left ? node->left : node->right;
+      childParent = node->parent;
+      replaceChild(node->parent, node, child);
+      if(child)
+        child->parent = node->parent;
+    }
+    else {
+      // the successor takes node's place and colour
+      RedBlackLinks* successor = removed;
+      removedRed = successor->red;
+      child = successor->right;
+      if(successor->parent == node)
+        childParent = successor;
+      else {
+        childParent = successor->parent;
+        childParent->left = child;
+        if(child)
+          child->parent = childParent;
+        successor->right = node->right;
+        node->right->parent = successor;
+      }
+      replaceChild(node->parent, node, successor);
+      successor->parent = node->parent;
+      successor->left = node->left;
+      node->left->parent = successor;
+      successor->red = node->red;
+      successor->size = node->size;
+    }
+
+    if(!removedRed)
+      eraseFixup(child, childParent);
+  }
+
+  static RedBlackLinks* minimum(RedBlackLinks* node) {
+    while(node->left)
+      node = node->left;
+    return node;
+  }
+
+  static RedBlackLinks* maximum(RedBlackLinks* node) {
+    while(node->right)
+      node = node->right;
+    return node;
+  }
+
+  // in-order successor, null after the last node
+  static RedBlackLinks* next(RedBlackLinks* node) {
+    if(node->right)
+      return minimum(node->right);
+    while(node->parent && node == node->parent->right)
+      node = node->parent;
+    return node->parent;
+  }
+
+  // in-order predecessor, null before the first node
+  static RedBlackLinks* prev(RedBlackLinks* node) {
+    if(node->left)
+      return maximum(node->left);
+    while(node->parent && node == node->parent->left)
+      node = node->parent;
+    return node->parent;
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_REDBLACKTREE_H */
@@ -0,0 +1,589 @@
+#ifndef AISDI_MAPS_ROBINHOODSTORAGE_H
+#define AISDI_MAPS_ROBINHOODSTORAGE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "BitUtils.h"
+#include "HashMapStats.h"
+
+namespace aisdi
+{
+
+// Storage policy for HashMap: open addressing with linear probing and Robin Hood displacement.
+// Entries live inline in one slot array; the array has probeLimit extra slots past the last home
+// slot, so probe sequences never wrap and backward-shift deletion keeps iteration order stable.
+// The capacity is a power of two; Hasher is expected to mix its bits (see HashMixing.h).
+// Entries are shifted between slots with no way back, so their moves must not throw.
+struct RobinHoodStorage
+{
+  template <typename Value, typename Hasher, typename KeyEqual>
+  class Table;
+
+private:
+  // Hashes the (hash, source slot) entries standing in for real ones while a rebuild places them;
+  // the hash is taken as it is, so placing them can throw nothing but bad_alloc.
+  struct PlannedHash
+  {
+    std::size_t operator()(std::size_t hash) const noexcept {
+      return hash;
+    }
+  };
+};
+
+template <typename Value, typename Hasher, typename KeyEqual>
+class RobinHoodStorage::Table
+{
+public:
+  using value_type = Value;
+  using key_type = typename std::remove_const<typename value_type::first_type>::type;
+  using size_type = std::size_t;
+  using position = size_type;
+  // batched lookups prefetch the home slots of keys ahead, see prefetch
+  using prefetches_batches = std::true_type;
+
+protected:
+  static constexpr size_type MIN_CAPACITY = 8;
+  static constexpr int EMPTY = -1;
+
+  // An entry is value_type to the user and a pair with a mutable key while it is moved between
+  // slots, so string keys move instead of being copied.
+  using mutable_value_type = std::pair<key_type, typename value_type::second_type>;
+
+  static_assert(std::is_nothrow_move_constructible<mutable_value_type>::value,
+                "RobinHoodStorage shifts entries between slots, their moves must not throw");
+
+  struct Slot
+  {
+    int distance;
+    typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type storage;
+
+    value_type& value() {
+      return *reinterpret_cast<value_type*>(&storage);
+    }
+
+    mutable_value_type& mutableValue() {
+      return *reinterpret_cast<mutable_value_type*>(&storage);
+    }
+  };
+
+  Slot* slots;
+  size_type capacity;
+  size_type slotCount;
+  int probeLimit;
+  size_type size;
+  float maxLoadFactor;
+  Hasher hasher;
+  KeyEqual keyEqual;
+  FindCounters counters;
+
+  // moves copy the source's hasher and key-equal and swap them, so they can throw only if those can
+  using nothrow_move = std::integral_constant<bool,
+    std::is_nothrow_copy_constructible<Hasher>::value && std::is_nothrow_copy_constructible<KeyEqual>::value &&
+    std::is_nothrow_move_assignable<Hasher>::value && std::is_nothrow_move_assignable<KeyEqual>::value>;
+
+  static unsigned log2(size_type n) {
+    unsigned result = 0;
+    while(n >>= 1)
+      ++result;
+    return result;
+  }
+
+  static int probeLimitFor(size_type newCapacity) {
+    return static_cast<int>(std::max(4u, std::min(log2(newCapacity), 64u)));
+  }
+
+  static size_type capacityFor(size_type n) {
+    size_type result = MIN_CAPACITY;
+    while(result < n)
+      result *= 2;
+    return result;
+  }
+
+  size_type capacityNeededFor(size_type elements) const {
+    return static_cast<size_type>(static_cast<double>(elements) / maxLoadFactor) + 1;
+  }
+
+  void allocate(size_type newCapacity, int newProbeLimit) {
+    slots = new Slot[newCapacity + newProbeLimit];
+    capacity = newCapacity;
+    probeLimit = newProbeLimit;
+    slotCount = newCapacity + newProbeLimit;
+    for(size_type i = 0; i < slotCount; ++i)
+      slots[i].distance = EMPTY;
+  }
+
+  // destroys every entry, the slot array is kept
+  void destroyEntries() {
+    for(size_type i = 0; i < slotCount; ++i) {
+      if(slots[i].distance != EMPTY) {
+        slots[i].value().~value_type();
+        slots[i].distance = EMPTY;
+      }
+    }
+    size = 0;
+  }
+
+  void destroyAll() {
+    for(size_type i = 0; i < slotCount; ++i)
+      if(slots[i].distance != EMPTY)
+        slots[i].value().~value_type();
+    delete [] slots;
+  }
+
+  // copies other slot by slot, nothing is rehashed; the slot array is reused when the layouts
+  // match. Leaves the table empty if a copy throws.
+  void cloneFrom(const Table& other) {
+    if(slots)
+      destroyEntries();
+    if(capacity != other.capacity || probeLimit != other.probeLimit) {
+      delete [] slots;
+      slots = nullptr;
+      capacity = slotCount = 0;
+      probeLimit = 0;
+    }
+
+    try {
+      if(!slots && other.slots)
+        allocate(other.capacity, other.probeLimit);
+      for(size_type i = 0; i < slotCount; ++i) {
+        if(other.slots[i].distance == EMPTY)
+          continue;
+        new (&slots[i].storage) value_type(other.slots[i].value());
+        slots[i].distance = other.slots[i].distance;
+        ++size;
+      }
+    }
+    catch(...) {
+      clear();
+      throw;
+    }
+  }
+
+  using PlannedHash = RobinHoodStorage::PlannedHash;
+  using Plan = Table<std::pair<const size_type, size_type>, PlannedHash, std::equal_to<size_type>>;
+
+  template <typename V, typename H, typename E>
+  friend class RobinHoodStorage::Table;
+
+  // Entries are placed through a Plan first: every hash is taken and every probe overflow handled
+  // before the first entry moves. A plan's own entries need none, a failure there loses nothing.
+  using plans_rebuild = std::integral_constant<bool, !std::is_same<Hasher, PlannedHash>::value>;
+
+  // Moves every entry into a freshly allocated slot array. The old slots go away with fresh after
+  // the swap, so a failure leaves this table as it was.
+  void rebuild(size_type newCapacity, int newProbeLimit) {
+    rebuild(newCapacity, newProbeLimit, plans_rebuild());
+  }
+
+  void rebuild(size_type newCapacity, int newProbeLimit, std::false_type) {
+    Table fresh(hasher, keyEqual);
+    fresh.maxLoadFactor = maxLoadFactor;
+    fresh.allocate(newCapacity, newProbeLimit);
+
+    for(size_type i = 0; i < slotCount; ++i)
+      if(slots[i].distance != EMPTY)
+        fresh.emplaceAbsent(hasher(slots[i].value().first), std::move(slots[i].mutableValue()));
+    swap(fresh);
+  }
+
+  // a move is not undone, so nothing past the first one may throw
+  void rebuild(size_type newCapacity, int newProbeLimit, std::true_type) {
+    Plan plan{PlannedHash(), std::equal_to<size_type>()};
+    plan.maxLoadFactor = maxLoadFactor;
+    plan.allocate(newCapacity, newProbeLimit);
+    for(size_type i = 0; i < slotCount; ++i) {
+      if(slots[i].distance != EMPTY) {
+        size_type hash = hasher(slots[i].value().first);
+        plan.emplaceAbsent(hash, hash, i);
+      }
+    }
+
+    Table fresh(hasher, keyEqual);
+    fresh.maxLoadFactor = maxLoadFactor;
+    fresh.allocate(plan.capacity, plan.probeLimit);
+    for(size_type i = 0; i < plan.slotCount; ++i) {
+      if(plan.slots[i].distance == EMPTY)
+        continue;
+      new (&fresh.slots[i].storage) mutable_value_type(std::move(slots[plan.slots[i].value().second].mutableValue()));
+      fresh.slots[i].distance = plan.slots[i].distance;
+      ++fresh.size;
+    }
+    swap(fresh);
+  }
+
+  void grow() {
+    size_type newCapacity = capacity ? capacity * 2 : MIN_CAPACITY;
+    rebuild(newCapacity, std::max(probeLimit, probeLimitFor(newCapacity)));
+  }
+
+  // A probe sequence got too long: allow longer ones while the table is sparse, grow it otherwise.
+  // Keys whose hashes all collide end up in one run as long as their count, searched linearly.
+  void handleOverflow() {
+    if(size < capacity * maxLoadFactor / 2)
+      rebuild(capacity, probeLimit * 2);
+    else
+      grow();
+  }
+
+  // moves the entry of slot from into the empty slot to, which it reaches at the given distance
+  void relocate(size_type from, size_type to, int distance) {
+    new (&slots[to].storage) mutable_value_type(std::move(slots[from].mutableValue()));
+    slots[to].distance = distance;
+    slots[from].mutableValue().~mutable_value_type();
+    slots[from].distance = EMPTY;
+  }
+
+  // Shifts the run starting at index one slot forward, so that a new entry fits there at the given
+  // distance; returns slotCount, without touching anything, when some entry would exceed the probe
+  // limit.
+  size_type openSlot(size_type index, int distance) {
+    if(distance >= probeLimit)
+      return slotCount;
+
+    size_type last = index;
+    while(slots[last].distance != EMPTY) {
+      if(slots[last].distance + 1 >= probeLimit || last + 1 == slotCount)
+        return slotCount;
+      ++last;
+    }
+
+    for(; last > index; --last)
+      relocate(last - 1, last, slots[last - 1].distance + 1);
+    slots[index].distance = distance;
+    return index;
+  }
+
+  // finds the slot a new entry with the given home slot belongs to and makes it free
+  size_type makeRoom(size_type index) {
+    int distance = 0;
+    while(slots[index].distance >= distance) {
+      ++index;
+      if(++distance >= probeLimit)
+        return slotCount;
+    }
+    return openSlot(index, distance);
+  }
+
+  // pulls the entries following a freed slot one step back, closing the gap
+  void shiftBack(size_type index) {
+    slots[index].distance = EMPTY;
+    for(size_type next = index + 1; next < slotCount && slots[next].distance > 0; ++next)
+      relocate(next, next - 1, slots[next].distance - 1);
+  }
+
+  // fills a slot opened by openSlot, closing it again if the entry cannot be built
+  template <typename... Args>
+  position constructAt(size_type index, Args&&... args) {
+    try {
+      new (&slots[index].storage) value_type(std::forward<Args>(args)...);
+    }
+    catch(...) {
+      shiftBack(index);
+      throw;
+    }
+    ++size;
+    return index;
+  }
+
+  // the key with the given hash must not be present yet, args build the entry
+  template <typename... Args>
+  position emplaceAbsent(size_type hash, Args&&... args) {
+    for(;;) {
+      size_type index = makeRoom(hash & (capacity - 1));
+      if(index != slotCount)
+        return constructAt(index, std::forward<Args>(args)...);
+      handleOverflow();
+    }
+  }
+
+  void shrinkIfNeeded() {
+    if(capacity > MIN_CAPACITY && size < capacity * maxLoadFactor / 4) {
+      size_type target = capacityFor(capacityNeededFor(size * 2));
+      if(target < capacity)
+        rebuild(target, probeLimitFor(target));
+    }
+  }
+
+public:
+  // slots are allocated on the first insert, so empty tables own no memory
+  Table() : Table(Hasher(), KeyEqual()) {}
+
+  Table(const Hasher& hash, const KeyEqual& equal) :
+    slots(nullptr), capacity(0), slotCount(0), probeLimit(0), size(0), maxLoadFactor(0.8f),
+    hasher(hash), keyEqual(equal) {}
+
+  Table(const Table& other) : Table(other.hasher, other.keyEqual) {
+    maxLoadFactor = other.maxLoadFactor;
+    cloneFrom(other);
+  }
+
+  Table(Table&& other) noexcept(nothrow_move::value) : Table(other.hasher, other.keyEqual) {
+    swap(other);
+  }
+
+  ~Table() {
+    if(slots)
+      destroyAll();
+  }
+
+  // reuses this table's slots where it can, see cloneFrom
+  Table& operator=(const Table& other) {
+    if(this == &other)
+      return *this;
+
+    hasher = other.hasher;
+    keyEqual = other.keyEqual;
+    maxLoadFactor = other.maxLoadFactor;
+    cloneFrom(other);
+    return *this;
+  }
+
+  // the source is left empty and without slots, whatever this table held is freed right away
+  Table& operator=(Table&& other) noexcept(nothrow_move::value) {
+    if(this == &other)
+      return *this;
+
+    Table toDel(std::move(*this));
+    swap(other);
+    return *this;
+  }
+
+  void swap(Table& other) {
+    std::swap(slots, other.slots);
+    std::swap(capacity, other.capacity);
+    std::swap(slotCount, other.slotCount);
+    std::swap(probeLimit, other.probeLimit);
+    std::swap(size, other.size);
+    std::swap(maxLoadFactor, other.maxLoadFactor);
+    std::swap(hasher, other.hasher);
+    std::swap(keyEqual, other.keyEqual);
+    counters.swap(other.counters);
+  }
+
+  const Hasher& getHasher() const {
+    return hasher;
+  }
+
+  const KeyEqual& getKeyEqual() const {
+    return keyEqual;
+  }
+
+  size_type getSize() const {
+    return size;
+  }
+
+  size_type getBucketCount() const {
+    return capacity;
+  }
+
+  float getMaxLoadFactor() const {
+    return maxLoadFactor;
+  }
+
+  // every entry takes a slot of its own, the table cannot be fuller than full
+  void setMaxLoadFactor(float factor) {
+    if(factor > 1.0f)
+      throw std::invalid_argument("Max load factor of Robin Hood storage cannot exceed 1");
+    maxLoadFactor = factor;
+    if(size > capacity * maxLoadFactor)
+      rehash(0);
+  }
+
+  // sets capacity to at least n, never below what the current size and max load factor require
+  void rehash(size_type n) {
+    if(!slots && !n)
+      return;
+    size_type target = capacityFor(std::max(n, capacityNeededFor(size)));
+    if(target != capacity)
+      rebuild(target, probeLimitFor(target));
+  }
+
+  // makes room for n elements without further rehashing
+  void reserve(size_type n) {
+    if(!n)
+      return;
+    size_type target = capacityFor(capacityNeededFor(n));
+    if(target > capacity)
+      rebuild(target, probeLimitFor(target));
+  }
+
+  // destroys all entries and frees the slot array
+  void clear() {
+    if(slots)
+      destroyAll();
+    slots = nullptr;
+    capacity = slotCount = size = 0;
+    probeLimit = 0;
+  }
+
+  position first() const {
+    if(!size)
+      return end();
+    return next(static_cast<size_type>(-1));
+  }
+
+  position end() const {
+    return slotCount;
+  }
+
+  position next(position pos) const {
+    do
+      ++pos;
+    while(pos < slotCount && slots[pos].distance == EMPTY);
+    return pos;
+  }
+
+  // pos must not be the first position
+  position prev(position pos) const {
+    do
+      --pos;
+    while(slots[pos].distance == EMPTY);
+    return pos;
+  }
+
+  value_type& at(position pos) const {
+    return slots[pos].value();
+  }
+
+  // entries of a cluster are ordered by home slot, so the scan stops at the first poorer entry
+  position find(const key_type& key) const {
+    if(!size) {
+      counters.record(0, false);
+      return end();
+    }
+    return findHashed(key, hasher(key));
+  }
+
+  // batched lookups call prefetch for a key well before prefetchEntry, and that well before findHashed
+  void prefetch(size_type hash) const {
+    if(slots)
+      prefetchRead(&slots[hash & (capacity - 1)]);
+  }
+
+  // entries live in the slots themselves, the home slot was prefetched already
+  void prefetchEntry(size_type) const {}
+
+  // hash has to come from getHasher(), lets callers hash a key once for several lookups
+  position findHashed(const key_type& key, size_type hash) const {
+    if(!size) {
+      counters.record(0, false);
+      return end();
+    }
+    size_type index = hash & (capacity - 1);
+    int distance = 0;
+    for(; slots[index].distance >= distance; ++index, ++distance) {
+      if(keyEqual(key, slots[index].value().first)) {
+        counters.record(distance + 1, true);
+        return index;
+      }
+    }
+    counters.record(distance + 1, false);
+    return end();
+  }
+
+  // every entry is a chain as long as the slots a lookup inspects to reach it, its distance plus one
+  HashMapStats getStats() const {
+    HashMapStats stats;
+    stats.size = stats.occupiedBuckets = size;
+    stats.bucketCount = capacity;
+    stats.loadFactor = capacity ? static_cast<float>(size) / capacity : 0.0f;
+    for(size_type i = 0; i < slotCount; ++i)
+      if(slots[i].distance != EMPTY)
+        stats.addChain(slots[i].distance + 1);
+    stats.bytesUsed = sizeof(Table) + slotCount * sizeof(Slot);
+    counters.fill(stats);
+    return stats;
+  }
+
+  void resetCounters() {
+    counters.reset();
+  }
+
+  // entry's key must not be present yet
+  position insert(const value_type& entry) {
+    if(size + 1 > capacity * maxLoadFactor)
+      grow();
+    return emplaceAbsent(hasher(entry.first), entry);
+  }
+
+  // the probe that misses key ends exactly where the new entry belongs, so it is opened right there;
+  // only growing the table or raising the probe limit costs a second probe
+  template <typename... Args>
+  std::pair<position, bool> tryEmplace(const key_type& key, Args&&... args) {
+    return tryEmplaceHashed(hasher(key), key, std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  std::pair<position, bool> tryEmplaceHashed(size_type hash, const key_type& key, Args&&... args) {
+    if(slots) {
+      size_type index = hash & (capacity - 1);
+      int distance = 0;
+      for(; slots[index].distance >= distance; ++index, ++distance)
+        if(keyEqual(key, slots[index].value().first))
+          return std::make_pair(index, false);
+
+      if(size + 1 <= capacity * maxLoadFactor) {
+        index = openSlot(index, distance);
+        if(index != slotCount)
+          return std::make_pair(constructAt(index, std::forward<Args>(args)...), true);
+        handleOverflow();
+      }
+      else
+        grow();
+    }
+    else
+      grow();
+    return std::make_pair(emplaceAbsent(hash, std::forward<Args>(args)...), true);
+  }
+
+  // the entry has to be built before its key is known; it is moved into its slot afterwards
+  template <typename... Args>
+  std::pair<position, bool> emplace(Args&&... args) {
+    value_type entry(std::forward<Args>(args)...);
+    return tryEmplace(entry.first, std::move(entry));
+  }
+
+  // removes the entry without shrinking the table; the rest of its cluster moves back one slot,
+  // so the entry that followed it may now be at pos itself
+  position eraseAndAdvance(position pos) {
+    slots[pos].value().~value_type();
+    --size;
+    shiftBack(pos);
+    return slots[pos].distance != EMPTY ? pos : next(pos);
+  }
+
+  // as above; tracked, a position behind pos, is moved back with its entry if the shift takes it
+  position eraseAndAdvance(position pos, position& tracked) {
+    size_type runEnd = pos + 1;
+    while(runEnd < slotCount && slots[runEnd].distance > 0)
+      ++runEnd;
+    if(tracked > pos && tracked < runEnd)
+      --tracked;
+    return eraseAndAdvance(pos);
+  }
+
+  // the entry is gone before the table shrinks, so a shrink that fails is skipped rather than
+  // reported; the table keeps its slots and erase does not throw
+  void erase(position pos) {
+    eraseAndAdvance(pos);
+    try {
+      shrinkIfNeeded();
+    }
+    catch(...) {
+    }
+  }
+};
+
+template <typename Value, typename Hasher, typename KeyEqual>
+constexpr typename RobinHoodStorage::Table<Value, Hasher, KeyEqual>::size_type
+  RobinHoodStorage::Table<Value, Hasher, KeyEqual>::MIN_CAPACITY;
+
+}
+
+#endif /* AISDI_MAPS_ROBINHOODSTORAGE_H */
@@ -0,0 +1,499 @@
+#ifndef AISDI_MAPS_SMALLSTORAGE_H
+#define AISDI_MAPS_SMALLSTORAGE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "BitUtils.h"
+#include "ChainedStorage.h"
+#include "HashMapStats.h"
+
+namespace aisdi
+{
+
+// Storage policy for HashMap that keeps up to N entries inline in the table object, found by a
+// linear scan over their keys with no hashing at all, and moves them into a table of Storage once
+// the N+1st key comes in. A small map thus allocates nothing; the hashed table, once there, stays
+// until the map is cleared or emptied. Inline entries sit in fixed slots marked in a bit mask,
+// so erasing one moves nothing and positions of the others stay valid.
+template <std::size_t N = 16, typename Storage = ChainedStorage>
+struct SmallStorage
+{
+  static_assert(N > 0 && N <= 64, "Inline capacity has to fit the 64 bit slot mask");
+
+  template <typename Value, typename Hasher, typename KeyEqual>
+  class Table;
+};
+
+template <std::size_t N, typename Storage>
+template <typename Value, typename Hasher, typename KeyEqual>
+class SmallStorage<N, Storage>::Table
+{
+public:
+  using value_type = Value;
+  using key_type = typename std::remove_const<typename value_type::first_type>::type;
+  using size_type = std::size_t;
+
+protected:
+  using hashed_table = typename Storage::template Table<value_type, Hasher, KeyEqual>;
+  using hashed_position = typename hashed_table::position;
+
+  static constexpr size_type WORD_BITS = 64;
+
+public:
+  // index is the inline slot, or N for the end and for every position of the hashed table
+  struct Position
+  {
+    size_type index;
+    hashed_position inner;
+
+    bool operator==(const Position& other) const {
+      return index == other.index && inner == other.inner;
+    }
+
+    bool operator!=(const Position& other) const {
+      return !(*this == other);
+    }
+  };
+  using position = Position;
+  using prefetches_batches = typename hashed_table::prefetches_batches;
+
+protected:
+  // mutable as the hashed tables' entries, lookups hand out modifiable entries of a const table
+  mutable typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type entries[N];
+  std::uint64_t used;
+  bool spilled;
+  hashed_table hashed;
+  FindCounters counters;
+
+  // An inline entry is value_type to the user and a pair with a mutable key while it moves to
+  // another table, so string keys move instead of being copied.
+  using mutable_value_type = std::pair<key_type, typename value_type::second_type>;
+
+  using nothrow_move = std::integral_constant<bool,
+    std::is_nothrow_move_constructible<mutable_value_type>::value &&
+    std::is_nothrow_move_constructible<hashed_table>::value>;
+
+  value_type& entry(size_type index) const {
+    return *reinterpret_cast<value_type*>(&entries[index]);
+  }
+
+  mutable_value_type& mutableEntry(size_type index) const {
+    return *reinterpret_cast<mutable_value_type*>(&entries[index]);
+  }
+
+  static position inlineAt(size_type index) {
+    return Position{index, hashed_position()};
+  }
+
+  static position wrap(hashed_position pos) {
+    return Position{N, pos};
+  }
+
+  static std::pair<position, bool> wrap(std::pair<hashed_position, bool> result) {
+    return std::make_pair(wrap(result.first), result.second);
+  }
+
+  // slots in use from index on
+  std::uint64_t usedFrom(size_type index) const {
+    return index >= WORD_BITS ? 0 : used & (~std::uint64_t(0) << index);
+  }
+
+  // slots in use below index
+  std::uint64_t usedBelow(size_type index) const {
+    return index >= WORD_BITS ? used : used & ~(~std::uint64_t(0) << index);
+  }
+
+  size_type inlineSize() const {
+    return countOnes(used);
+  }
+
+  // slot of key or N, probes counts the keys compared
+  size_type scan(const key_type& key, size_type& probes) const {
+    for(std::uint64_t mask = used; mask; mask &= mask - 1) {
+      size_type index = countTrailingZeros(mask);
+      ++probes;
+      if(hashed.getKeyEqual()(key, entry(index).first))
+        return index;
+    }
+    return N;
+  }
+
+  template <typename... Args>
+  position constructInline(Args&&... args) {
+    size_type index = countTrailingZeros(~used);
+    new (&entries[index]) value_type(std::forward<Args>(args)...);
+    used |= std::uint64_t(1) << index;
+    return inlineAt(index);
+  }
+
+  void destroyInline() {
+    for(std::uint64_t mask = used; mask; mask &= mask - 1)
+      entry(countTrailingZeros(mask)).~value_type();
+    used = 0;
+  }
+
+  // copies every inline entry of other into the same slot here, this table has none
+  void copyInline(const Table& other) {
+    for(std::uint64_t mask = other.used; mask; mask &= mask - 1) {
+      size_type index = countTrailingZeros(mask);
+      new (&entries[index]) value_type(other.entry(index));
+      used |= std::uint64_t(1) << index;
+    }
+  }
+
+  // moves every inline entry of other into the same slot here, this table has none; if a move
+  // throws, every entry is still in one of the two tables
+  void takeInline(Table& other) {
+    for(std::uint64_t mask = other.used; mask; mask &= mask - 1) {
+      size_type index = countTrailingZeros(mask);
+      new (&entries[index]) mutable_value_type(std::move(other.mutableEntry(index)));
+      used |= std::uint64_t(1) << index;
+      other.mutableEntry(index).~mutable_value_type();
+      other.used &= ~(std::uint64_t(1) << index);
+    }
+  }
+
+  // the inline half of tryEmplace; false when key is missing and every slot is taken
+  template <typename... Args>
+  bool tryEmplaceInline(std::pair<position, bool>& result, const key_type& key, Args&&... args) {
+    size_type probes = 0;
+    size_type index = scan(key, probes);
+    if(index != N)
+      result = std::make_pair(inlineAt(index), false);
+    else if(inlineSize() < N)
+      result = std::make_pair(constructInline(std::forward<Args>(args)...), true);
+    else
+      return false;
+    return true;
+  }
+
+  // whether std::move_if_noexcept moves an entry rather than copying it
+  using moves_entries = std::integral_constant<bool,
+    std::is_nothrow_move_constructible<value_type>::value || !std::is_copy_constructible<value_type>::value>;
+
+  // hands the values moved into the hashed table back to their inline slots
+  void unspill(std::true_type) {
+    for(hashed_position pos = hashed.first(); pos != hashed.end(); pos = hashed.next(pos)) {
+      size_type probes = 0;
+      entry(scan(hashed.at(pos).first, probes)).second = std::move(hashed.at(pos).second);
+    }
+  }
+
+  void unspill(std::false_type) {}
+
+  // Puts the inline entries into the hashed table, made big enough for n entries, and drops them
+  // only once all are in. Entries are moved unless that could throw, as in a rehash; a failure
+  // moves the values back, or leaves the copied ones inline untouched.
+  void spill(size_type n) {
+    try {
+      hashed.reserve(std::max(n, inlineSize()));
+      for(std::uint64_t mask = used; mask; mask &= mask - 1) {
+        value_type& item = entry(countTrailingZeros(mask));
+        hashed.tryEmplace(item.first, std::move_if_noexcept(item));
+      }
+    }
+    catch(...) {
+      unspill(moves_entries());
+      hashed.clear();
+      throw;
+    }
+    destroyInline();
+    spilled = true;
+  }
+
+public:
+  Table() : Table(Hasher(), KeyEqual()) {}
+
+  Table(const Hasher& hash, const KeyEqual& equal) : used(0), spilled(false), hashed(hash, equal) {}
+
+  Table(const Table& other) : used(0), spilled(other.spilled), hashed(other.hashed) {
+    try {
+      copyInline(other);
+    }
+    catch(...) {
+      destroyInline();
+      throw;
+    }
+  }
+
+  // inline entries are moved one by one, so this cannot throw unless moving them or the hashed
+  // table can
+  Table(Table&& other) noexcept(nothrow_move::value) :
+    Table(other.hashed.getHasher(), other.hashed.getKeyEqual()) {
+    swap(other);
+  }
+
+  ~Table() {
+    destroyInline();
+  }
+
+  // the hashed table is cloned by its own rules, inline entries keep their slots
+  Table& operator=(const Table& other) {
+    if(this == &other)
+      return *this;
+
+    destroyInline();
+    hashed = other.hashed;
+    spilled = other.spilled;
+    try {
+      copyInline(other);
+    }
+    catch(...) {
+      clear();
+      throw;
+    }
+    return *this;
+  }
+
+  // the source is left empty and without buckets
+  Table& operator=(Table&& other) noexcept(nothrow_move::value) {
+    if(this == &other)
+      return *this;
+
+    Table toDel(std::move(*this));
+    swap(other);
+    return *this;
+  }
+
+  // Unlike the hashed tables this moves the inline entries one by one. If a move throws, each
+  // table keeps the entries it holds by then and those parked on the way are lost; a table left
+  // with a hashed table in use drops its inline entries, so its size matches what it holds.
+  void swap(Table& other) {
+    Table held(hashed.getHasher(), hashed.getKeyEqual());
+    std::swap(spilled, other.spilled);
+    hashed.swap(other.hashed);
+    counters.swap(other.counters);
+    try {
+      held.takeInline(*this);
+      takeInline(other);
+      other.takeInline(held);
+    }
+    catch(...) {
+      if(spilled)
+        destroyInline();
+      if(other.spilled)
+        other.destroyInline();
+      throw;
+    }
+  }
+
+  const Hasher& getHasher() const {
+    return hashed.getHasher();
+  }
+
+  const KeyEqual& getKeyEqual() const {
+    return hashed.getKeyEqual();
+  }
+
+  size_type getSize() const {
+    return spilled ? hashed.getSize() : inlineSize();
+  }
+
+  // inline entries take no buckets
+  size_type getBucketCount() const {
+    return spilled ? hashed.getBucketCount() : 0;
+  }
+
+  float getMaxLoadFactor() const {
+    return hashed.getMaxLoadFactor();
+  }
+
+  void setMaxLoadFactor(float factor) {
+    hashed.setMaxLoadFactor(factor);
+  }
+
+  // asking for buckets gives up the inline slots
+  void rehash(size_type n) {
+    if(!spilled && !n)
+      return;
+    if(!spilled)
+      spill(0);
+    hashed.rehash(n);
+  }
+
+  // room for more than N elements is made in the hashed table right away
+  void reserve(size_type n) {
+    if(spilled)
+      hashed.reserve(n);
+    else if(n > N)
+      spill(n);
+  }
+
+  // goes back to inline slots
+  void clear() {
+    destroyInline();
+    hashed.clear();
+    spilled = false;
+  }
+
+  position first() const {
+    if(spilled)
+      return wrap(hashed.first());
+    return used ? inlineAt(countTrailingZeros(used)) : end();
+  }
+
+  position end() const {
+    return spilled ? wrap(hashed.end()) : inlineAt(N);
+  }
+
+  position next(position pos) const {
+    if(spilled)
+      return wrap(hashed.next(pos.inner));
+    std::uint64_t rest = usedFrom(pos.index + 1);
+    return rest ? inlineAt(countTrailingZeros(rest)) : end();
+  }
+
+  // pos must not be the first position
+  position prev(position pos) const {
+    if(spilled)
+      return wrap(hashed.prev(pos.inner));
+    return inlineAt(WORD_BITS - 1 - countLeadingZeros(usedBelow(pos.index)));
+  }
+
+  value_type& at(position pos) const {
+    return pos.index < N ? entry(pos.index) : hashed.at(pos.inner);
+  }
+
+  position find(const key_type& key) const {
+    if(spilled)
+      return wrap(hashed.find(key));
+    size_type probes = 0;
+    size_type index = scan(key, probes);
+    counters.record(probes, index != N);
+    return inlineAt(index);
+  }
+
+  void prefetch(size_type hash) const {
+    if(spilled)
+      hashed.prefetch(hash);
+  }
+
+  void prefetchEntry(size_type hash) const {
+    if(spilled)
+      hashed.prefetchEntry(hash);
+  }
+
+  // inline entries are found without the hash
+  position findHashed(const key_type& key, size_type hash) const {
+    if(spilled)
+      return wrap(hashed.findHashed(key, hash));
+    return find(key);
+  }
+
+  // Inline entries are one chain as long as the keys a miss compares, the hashed table reports
+  // its own layout. Lookups of both kinds are counted.
+  HashMapStats getStats() const {
+    HashMapStats stats;
+    if(spilled) {
+      stats = hashed.getStats();
+      stats.bytesUsed += sizeof(Table) - sizeof(hashed_table);
+    }
+    else {
+      stats.size = inlineSize();
+      if(stats.size)
+        stats.addChain(stats.size);
+      stats.bytesUsed = sizeof(Table);
+    }
+    HashMapStats scans;
+    counters.fill(scans);
+    stats.finds += scans.finds;
+    stats.hits += scans.hits;
+    stats.misses += scans.misses;
+    stats.probes += scans.probes;
+    return stats;
+  }
+
+  void resetCounters() {
+    counters.reset();
+    hashed.resetCounters();
+  }
+
+  // entry's key must not be present yet
+  position insert(const value_type& entry) {
+    if(spilled)
+      return wrap(hashed.insert(entry));
+    if(inlineSize() < N)
+      return constructInline(entry);
+    spill(N + 1);
+    return wrap(hashed.insert(entry));
+  }
+
+  template <typename... Args>
+  std::pair<position, bool> tryEmplace(const key_type& key, Args&&... args) {
+    if(!spilled) {
+      std::pair<position, bool> result;
+      if(tryEmplaceInline(result, key, std::forward<Args>(args)...))
+        return result;
+      spill(N + 1);
+    }
+    return wrap(hashed.tryEmplace(key, std::forward<Args>(args)...));
+  }
+
+  template <typename... Args>
+  std::pair<position, bool> tryEmplaceHashed(size_type hash, const key_type& key, Args&&... args) {
+    if(!spilled) {
+      std::pair<position, bool> result;
+      if(tryEmplaceInline(result, key, std::forward<Args>(args)...))
+        return result;
+      spill(N + 1);
+    }
+    return wrap(hashed.tryEmplaceHashed(hash, key, std::forward<Args>(args)...));
+  }
+
+  // the entry has to be built before its key is known
+  template <typename... Args>
+  std::pair<position, bool> emplace(Args&&... args) {
+    value_type entry(std::forward<Args>(args)...);
+    return tryEmplace(entry.first, std::move(entry));
+  }
+
+  // removes the entry without shrinking the hashed table and returns the position of the next one
+  position eraseAndAdvance(position pos) {
+    if(pos.index < N) {
+      entry(pos.index).~value_type();
+      used &= ~(std::uint64_t(1) << pos.index);
+      return next(pos);
+    }
+    position following = wrap(hashed.eraseAndAdvance(pos.inner));
+    if(hashed.getSize())
+      return following;
+    clear();
+    return end();
+  }
+
+  // as above; tracked, a position behind pos, is kept on its entry as the hashed table keeps it
+  position eraseAndAdvance(position pos, position& tracked) {
+    if(pos.index < N)
+      return eraseAndAdvance(pos);
+    position following = wrap(hashed.eraseAndAdvance(pos.inner, tracked.inner));
+    if(hashed.getSize())
+      return following;
+    clear();
+    return tracked = end();
+  }
+
+  // a hashed table emptied this way is freed, so the next entries go inline again
+  void erase(position pos) {
+    if(pos.index < N) {
+      eraseAndAdvance(pos);
+      return;
+    }
+    hashed.erase(pos.inner);
+    if(!hashed.getSize())
+      clear();
+  }
+};
+
+template <std::size_t N, typename Storage>
+template <typename Value, typename Hasher, typename KeyEqual>
+constexpr typename SmallStorage<N, Storage>::template Table<Value, Hasher, KeyEqual>::size_type
+  SmallStorage<N, Storage>::Table<Value, Hasher, KeyEqual>::WORD_BITS;
+
+}
+
+#endif /* AISDI_MAPS_SMALLSTORAGE_H */
@@ -0,0 +1,657 @@
+#ifndef AISDI_MAPS_SWISSSTORAGE_H
+#define AISDI_MAPS_SWISSSTORAGE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#if !defined(AISDI_SWISS_SCALAR) && (defined(__SSE2__) || defined(_M_X64))
+#  include <immintrin.h>
+#endif
+
+#include "BitUtils.h"
+#include "HashMapStats.h"
+
+namespace aisdi
+{
+
+// Control byte of a slot: EMPTY and DELETED have the sign bit set, a full slot keeps
+// the low 7 bits of its hash (h2), so one byte compare filters out almost every candidate.
+struct SwissControl
+{
+  static constexpr signed char EMPTY = -128;
+  static constexpr signed char DELETED = -2;
+  static constexpr signed char SENTINEL = -1;
+};
+
+// Set bits of a group match; Shift turns a bit number into a slot offset.
+template <typename Mask, unsigned Shift>
+class SwissBitMask
+{
+  Mask mask;
+
+public:
+  explicit SwissBitMask(Mask m) : mask(m) {}
+
+  explicit operator bool() const {
+    return mask != 0;
+  }
+
+  unsigned lowest() const {
+    return countTrailingZeros(mask) >> Shift;
+  }
+
+  void clearLowest() {
+    mask &= mask - 1;
+  }
+};
+
+// Portable fallback: eight control bytes per 64-bit word, matched with SWAR arithmetic.
+// match() may report false positives next to a real match; callers compare keys anyway.
+class SwissGroupScalar
+{
+  static constexpr std::uint64_t LSBS = 0x0101010101010101ull;
+  static constexpr std::uint64_t MSBS = 0x8080808080808080ull;
+
+  std::uint64_t ctrl;
+
+public:
+  static constexpr std::size_t WIDTH = 8;
+  using BitMask = SwissBitMask<std::uint64_t, 3>;
+
+  explicit SwissGroupScalar(const signed char* pos) {
+    std::memcpy(&ctrl, pos, sizeof(ctrl));
+  }
+
+  BitMask match(signed char h2) const {
+    std::uint64_t x = ctrl ^ (LSBS * static_cast<unsigned char>(h2));
+    return BitMask((x - LSBS) & ~x & MSBS);
+  }
+
+  BitMask matchEmpty() const {
+    return BitMask((ctrl & (~ctrl << 6)) & MSBS);
+  }
+
+  BitMask matchEmptyOrDeleted() const {
+    return BitMask((ctrl & (~ctrl << 7)) & MSBS);
+  }
+};
+
+#if !defined(AISDI_SWISS_SCALAR) && (defined(__SSE2__) || defined(_M_X64))
+// Sixteen control bytes compared at once, movemask gives one bit per slot.
+class SwissGroupSse2
+{
+  __m128i ctrl;
+
+public:
+  static constexpr std::size_t WIDTH = 16;
+  using BitMask = SwissBitMask<std::uint32_t, 0>;
+
+  explicit SwissGroupSse2(const signed char* pos) :
+    ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos))) {}
+
+  BitMask match(signed char h2) const {
+    return BitMask(static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl))));
+  }
+
+  BitMask matchEmpty() const {
+    return match(SwissControl::EMPTY);
+  }
+
+  BitMask matchEmptyOrDeleted() const {
+    return BitMask(static_cast<std::uint32_t>(
+      _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(SwissControl::SENTINEL), ctrl))));
+  }
+};
+#endif
+
+#if !defined(AISDI_SWISS_SCALAR) && defined(__AVX2__)
+// AVX2 flavour of the same thing, thirty-two slots per compare.
+class SwissGroupAvx2
+{
+  __m256i ctrl;
+
+public:
+  static constexpr std::size_t WIDTH = 32;
+  using BitMask = SwissBitMask<std::uint32_t, 0>;
+
+  explicit SwissGroupAvx2(const signed char* pos) :
+    ctrl(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos))) {}
+
+  BitMask match(signed char h2) const {
+    return BitMask(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_set1_epi8(h2), ctrl))));
+  }
+
+  BitMask matchEmpty() const {
+    return match(SwissControl::EMPTY);
+  }
+
+  BitMask matchEmptyOrDeleted() const {
+    return BitMask(static_cast<std::uint32_t>(
+      _mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_set1_epi8(SwissControl::SENTINEL), ctrl))));
+  }
+};
+#endif
+
+// Chosen at build time from the target instruction set; define AISDI_SWISS_SCALAR to force the fallback.
+#if !defined(AISDI_SWISS_SCALAR) && defined(__AVX2__)
+#  define AISDI_SWISS_SIMD 1
+using SwissDefaultGroup = SwissGroupAvx2;
+#elif !defined(AISDI_SWISS_SCALAR) && (defined(__SSE2__) || defined(_M_X64))
+#  define AISDI_SWISS_SIMD 1
+using SwissDefaultGroup = SwissGroupSse2;
+#else
+using SwissDefaultGroup = SwissGroupScalar;
+#endif
+
+// Storage policy for HashMap: open addressing over groups of slots, with one control byte per slot
+// kept in a separate array. Probing loads a whole group of control bytes and matches it against
+// the 7-bit hash fingerprint, so a miss is usually settled by a single group compare.
+// Hasher is expected to mix its bits (see HashMixing.h): h2 comes from the low 7 bits, h1 from the rest.
+template <typename Group>
+struct BasicSwissStorage
+{
+  template <typename Value, typename Hasher, typename KeyEqual>
+  class Table;
+};
+
+using SwissStorage = BasicSwissStorage<SwissDefaultGroup>;
+
+template <typename Group>
+template <typename Value, typename Hasher, typename KeyEqual>
+class BasicSwissStorage<Group>::Table
+{
+public:
+  using value_type = Value;
+  using key_type = typename std::remove_const<typename value_type::first_type>::type;
+  using size_type = std::size_t;
+  using position = size_type;
+  // batched lookups prefetch the control bytes and home slots of keys ahead, see prefetch
+  using prefetches_batches = std::true_type;
+
+protected:
+  static constexpr size_type WIDTH = Group::WIDTH;
+  static constexpr size_type MIN_CAPACITY = WIDTH < 16 ? 16 : WIDTH;
+  static constexpr float MAX_LOAD_FACTOR = 0.9375f;
+
+  using Slot = typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type;
+
+  // ctrl has WIDTH extra bytes mirroring the first ones, so a group load never wraps
+  signed char* ctrl;
+  Slot* slots;
+  size_type capacity;
+  size_type size;
+  size_type deleted;
+  float maxLoadFactor;
+  Hasher hasher;
+  KeyEqual keyEqual;
+  FindCounters counters;
+
+  // moves copy the source's hasher and key-equal and swap them, so they can throw only if those can
+  using nothrow_move = std::integral_constant<bool,
+    std::is_nothrow_copy_constructible<Hasher>::value && std::is_nothrow_copy_constructible<KeyEqual>::value &&
+    std::is_nothrow_move_assignable<Hasher>::value && std::is_nothrow_move_assignable<KeyEqual>::value>;
+
+  size_type hashFunction(const key_type& key) const {
+    return hasher(key);
+  }
+
+  static size_type h1(size_type hash) {
+    return hash >> 7;
+  }
+
+  static signed char h2(size_type hash) {
+    return static_cast<signed char>(hash & 0x7F);
+  }
+
+  static bool isFull(signed char control) {
+    return control >= 0;
+  }
+
+  value_type& value(size_type index) const {
+    return *reinterpret_cast<value_type*>(&slots[index]);
+  }
+
+  void setControl(size_type index, signed char control) {
+    ctrl[index] = control;
+    if(index < WIDTH)
+      ctrl[capacity + index] = control;
+  }
+
+  static size_type capacityFor(size_type n) {
+    size_type result = MIN_CAPACITY;
+    while(result < n)
+      result *= 2;
+    return result;
+  }
+
+  size_type capacityNeededFor(size_type elements) const {
+    return static_cast<size_type>(static_cast<double>(elements) / maxLoadFactor) + 1;
+  }
+
+  void allocate(size_type newCapacity) {
+    signed char* newCtrl = new signed char[newCapacity + WIDTH];
+    try {
+      slots = new Slot[newCapacity];
+    }
+    catch(...) {
+      delete [] newCtrl;
+      throw;
+    }
+    ctrl = newCtrl;
+    std::memset(ctrl, static_cast<unsigned char>(SwissControl::EMPTY), newCapacity + WIDTH);
+    capacity = newCapacity;
+  }
+
+  // destroys every entry and marks all slots empty, both arrays are kept
+  void destroyEntries() {
+    for(size_type i = 0; i < capacity; ++i)
+      if(isFull(ctrl[i]))
+        value(i).~value_type();
+    std::memset(ctrl, static_cast<unsigned char>(SwissControl::EMPTY), capacity + WIDTH);
+    size = deleted = 0;
+  }
+
+  void destroyAll() {
+    for(size_type i = 0; i < capacity; ++i)
+      if(isFull(ctrl[i]))
+        value(i).~value_type();
+    delete [] ctrl;
+    delete [] slots;
+  }
+
+  // first slot on the probe sequence of hash that can take a new entry
+  size_type findFirstNonFull(size_type hash) const {
+    size_type mask = capacity - 1;
+    size_type pos = h1(hash) & mask;
+    for(size_type step = WIDTH; ; pos = (pos + step) & mask, step += WIDTH) {
+      auto candidates = Group(ctrl + pos).matchEmptyOrDeleted();
+      if(candidates)
+        return (pos + candidates.lowest()) & mask;
+    }
+  }
+
+  // Moves every entry into freshly allocated arrays, or copies it when its move could throw,
+  // dropping all tombstones. Every hash is taken before the first entry moves and the old arrays
+  // go away with fresh after the swap, so a failure leaves this table as it was.
+  void rebuild(size_type newCapacity) {
+    Table fresh(hasher, keyEqual);
+    fresh.maxLoadFactor = maxLoadFactor;
+    fresh.allocate(newCapacity);
+
+    std::unique_ptr<size_type[]> hashes(new size_type[size]);
+    for(size_type i = 0, n = 0; i < capacity; ++i)
+      if(isFull(ctrl[i]))
+        hashes[n++] = hashFunction(value(i).first);
+
+    for(size_type i = 0, n = 0; i < capacity; ++i) {
+      if(!isFull(ctrl[i]))
+        continue;
+      size_type hash = hashes[n++];
+      size_type index = fresh.findFirstNonFull(hash);
+      new (&fresh.slots[index]) value_type(std::move_if_noexcept(value(i)));
+      fresh.setControl(index, h2(hash));
+      ++fresh.size;
+    }
+    swap(fresh);
+  }
+
+  // index has to be free, either empty or a tombstone
+  template <typename... Args>
+  position constructAt(size_type index, size_type hash, Args&&... args) {
+    new (&slots[index]) value_type(std::forward<Args>(args)...);
+    if(ctrl[index] == SwissControl::DELETED)
+      --deleted;
+    setControl(index, h2(hash));
+    ++size;
+    return index;
+  }
+
+  // copies other index by index, nothing is rehashed; tombstones are copied too, entries placed
+  // past them have to stay reachable. Both arrays are reused when the capacities match. Leaves
+  // the table empty if a copy throws.
+  void cloneFrom(const Table& other) {
+    if(ctrl)
+      destroyEntries();
+    if(capacity != other.capacity) {
+      delete [] ctrl;
+      delete [] slots;
+      ctrl = nullptr;
+      slots = nullptr;
+      capacity = 0;
+    }
+
+    try {
+      if(!ctrl && other.ctrl)
+        allocate(other.capacity);
+      for(size_type i = 0; i < capacity; ++i) {
+        if(!isFull(other.ctrl[i]))
+          continue;
+        new (&slots[i]) value_type(other.value(i));
+        setControl(i, other.ctrl[i]);
+        ++size;
+      }
+    }
+    catch(...) {
+      clear();
+      throw;
+    }
+    if(ctrl) {
+      std::memcpy(ctrl, other.ctrl, capacity + WIDTH);
+      deleted = other.deleted;
+    }
+  }
+
+  void shrinkIfNeeded() {
+    if(capacity > MIN_CAPACITY && size < capacity * maxLoadFactor / 4) {
+      size_type target = capacityFor(capacityNeededFor(size * 2));
+      if(target < capacity)
+        rebuild(target);
+    }
+  }
+
+public:
+  // arrays are allocated on the first insert, so empty tables own no memory
+  Table() : Table(Hasher(), KeyEqual()) {}
+
+  Table(const Hasher& hash, const KeyEqual& equal) :
+    ctrl(nullptr), slots(nullptr), capacity(0), size(0), deleted(0), maxLoadFactor(0.875f),
+    hasher(hash), keyEqual(equal) {}
+
+  Table(const Table& other) : Table(other.hasher, other.keyEqual) {
+    maxLoadFactor = other.maxLoadFactor;
+    cloneFrom(other);
+  }
+
+  Table(Table&& other) noexcept(nothrow_move::value) : Table(other.hasher, other.keyEqual) {
+    swap(other);
+  }
+
+  ~Table() {
+    if(ctrl)
+      destroyAll();
+  }
+
+  // reuses this table's arrays where it can, see cloneFrom
+  Table& operator=(const Table& other) {
+    if(this == &other)
+      return *this;
+
+    hasher = other.hasher;
+    keyEqual = other.keyEqual;
+    maxLoadFactor = other.maxLoadFactor;
+    cloneFrom(other);
+    return *this;
+  }
+
+  // the source is left empty and without arrays, whatever this table held is freed right away
+  Table& operator=(Table&& other) noexcept(nothrow_move::value) {
+    if(this == &other)
+      return *this;
+
+    Table toDel(std::move(*this));
+    swap(other);
+    return *this;
+  }
+
+  void swap(Table& other) {
+    std::swap(ctrl, other.ctrl);
+    std::swap(slots, other.slots);
+    std::swap(capacity, other.capacity);
+    std::swap(size, other.size);
+    std::swap(deleted, other.deleted);
+    std::swap(maxLoadFactor, other.maxLoadFactor);
+    std::swap(hasher, other.hasher);
+    std::swap(keyEqual, other.keyEqual);
+    counters.swap(other.counters);
+  }
+
+  const Hasher& getHasher() const {
+    return hasher;
+  }
+
+  const KeyEqual& getKeyEqual() const {
+    return keyEqual;
+  }
+
+  size_type getSize() const {
+    return size;
+  }
+
+  size_type getBucketCount() const {
+    return capacity;
+  }
+
+  float getMaxLoadFactor() const {
+    return maxLoadFactor;
+  }
+
+  // at least one slot has to stay empty for unsuccessful probes to stop
+  // a group has to keep an empty slot for probing to stop, so at most 15 of 16 slots are used
+  void setMaxLoadFactor(float factor) {
+    if(factor > MAX_LOAD_FACTOR)
+      throw std::invalid_argument("Max load factor of Swiss storage cannot exceed 0.9375");
+    maxLoadFactor = factor;
+    if(size + deleted > capacity * maxLoadFactor)
+      rehash(0);
+  }
+
+  // sets capacity to at least n, never below what the current size and max load factor require
+  void rehash(size_type n) {
+    if(!ctrl && !n)
+      return;
+    size_type target = capacityFor(std::max(n, capacityNeededFor(size)));
+    if(target != capacity || deleted)
+      rebuild(target);
+  }
+
+  // makes room for n elements without further rehashing
+  void reserve(size_type n) {
+    if(!n)
+      return;
+    size_type target = capacityFor(capacityNeededFor(n));
+    if(target > capacity)
+      rebuild(target);
+  }
+
+  // destroys all entries and frees both arrays
+  void clear() {
+    if(ctrl)
+      destroyAll();
+    ctrl = nullptr;
+    slots = nullptr;
+    capacity = size = deleted = 0;
+  }
+
+  position first() const {
+    if(!size)
+      return end();
+    return next(static_cast<size_type>(-1));
+  }
+
+  position end() const {
+    return capacity;
+  }
+
+  position next(position pos) const {
+    do
+      ++pos;
+    while(pos < capacity && !isFull(ctrl[pos]));
+    return pos;
+  }
+
+  // pos must not be the first position
+  position prev(position pos) const {
+    do
+      --pos;
+    while(!isFull(ctrl[pos]));
+    return pos;
+  }
+
+  value_type& at(position pos) const {
+    return value(pos);
+  }
+
+  position find(const key_type& key) const {
+    if(!size) {
+      counters.record(0, false);
+      return end();
+    }
+    return findHashed(key, hashFunction(key));
+  }
+
+  // batched lookups call prefetch for a key well before prefetchEntry, and that well before findHashed
+  void prefetch(size_type hash) const {
+    if(ctrl)
+      prefetchRead(ctrl + (h1(hash) & (capacity - 1)));
+  }
+
+  // the first slot of the home group, where a present key usually sits
+  void prefetchEntry(size_type hash) const {
+    if(ctrl)
+      prefetchRead(&slots[h1(hash) & (capacity - 1)]);
+  }
+
+  // hash has to come from getHasher(), lets callers hash a key once for several lookups
+  position findHashed(const key_type& key, size_type hash) const {
+    if(!size) {
+      counters.record(0, false);
+      return end();
+    }
+    signed char fingerprint = h2(hash);
+    size_type mask = capacity - 1;
+    size_type pos = h1(hash) & mask;
+    for(size_type step = WIDTH, groups = 1; ; pos = (pos + step) & mask, step += WIDTH, ++groups) {
+      Group group(ctrl + pos);
+      for(auto candidates = group.match(fingerprint); candidates; candidates.clearLowest()) {
+        size_type index = (pos + candidates.lowest()) & mask;
+        if(keyEqual(key, value(index).first)) {
+          counters.record(groups, true);
+          return index;
+        }
+      }
+      if(group.matchEmpty()) {
+        counters.record(groups, false);
+        return end();
+      }
+    }
+  }
+
+  // Every entry is a chain as long as the groups a lookup loads to reach it, probes count groups
+  // too. Slots do not keep their hash, so this hashes every key once more.
+  HashMapStats getStats() const {
+    HashMapStats stats;
+    stats.size = stats.occupiedBuckets = size;
+    stats.bucketCount = capacity;
+    stats.loadFactor = capacity ? static_cast<float>(size) / capacity : 0.0f;
+    size_type mask = capacity - 1;
+    for(size_type i = 0; i < capacity; ++i) {
+      if(!isFull(ctrl[i]))
+        continue;
+      size_type offset = (i - h1(hashFunction(value(i).first))) & mask;
+      size_type groups = 1;
+      for(size_type start = 0, step = WIDTH; ((offset - start) & mask) >= WIDTH; start += step, step += WIDTH)
+        ++groups;
+      stats.addChain(groups);
+    }
+    stats.bytesUsed = sizeof(Table) + capacity * (sizeof(Slot) + 1);
+    if(ctrl)
+      stats.bytesUsed += WIDTH;
+    counters.fill(stats);
+    return stats;
+  }
+
+  void resetCounters() {
+    counters.reset();
+  }
+
+  // entry's key must not be present yet
+  position insert(const value_type& entry) {
+    if(size + deleted + 1 > capacity * maxLoadFactor)
+      rebuild(std::max(capacityFor(capacityNeededFor(size + 1)), capacity));
+
+    size_type hash = hashFunction(entry.first);
+    return constructAt(findFirstNonFull(hash), hash, entry);
+  }
+
+  // one probe looks for key and remembers the first free slot on the way; a tombstone is reused
+  // without growing, only a fresh empty slot counts against the load factor
+  template <typename... Args>
+  std::pair<position, bool> tryEmplace(const key_type& key, Args&&... args) {
+    return tryEmplaceHashed(hashFunction(key), key, std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  std::pair<position, bool> tryEmplaceHashed(size_type hash, const key_type& key, Args&&... args) {
+    size_type index = capacity;
+    if(ctrl) {
+      signed char fingerprint = h2(hash);
+      size_type mask = capacity - 1;
+      size_type pos = h1(hash) & mask;
+      for(size_type step = WIDTH; ; pos = (pos + step) & mask, step += WIDTH) {
+        Group group(ctrl + pos);
+        for(auto candidates = group.match(fingerprint); candidates; candidates.clearLowest()) {
+          size_type found = (pos + candidates.lowest()) & mask;
+          if(keyEqual(key, value(found).first))
+            return std::make_pair(found, false);
+        }
+        if(index == capacity) {
+          auto free = group.matchEmptyOrDeleted();
+          if(free)
+            index = (pos + free.lowest()) & mask;
+        }
+        if(group.matchEmpty())
+          break;
+      }
+    }
+
+    if(index == capacity || (ctrl[index] == SwissControl::EMPTY && size + deleted + 1 > capacity * maxLoadFactor)) {
+      rebuild(std::max(capacityFor(capacityNeededFor(size + 1)), capacity));
+      index = findFirstNonFull(hash);
+    }
+    return std::make_pair(constructAt(index, hash, std::forward<Args>(args)...), true);
+  }
+
+  // the entry has to be built before its key is known; it is moved into its slot afterwards
+  template <typename... Args>
+  std::pair<position, bool> emplace(Args&&... args) {
+    value_type entry(std::forward<Args>(args)...);
+    return tryEmplace(entry.first, std::move(entry));
+  }
+
+  // leaves a tombstone, so entries behind it on some probe sequence stay reachable
+  // removes the entry without shrinking the table, the others stay where they are
+  position eraseAndAdvance(position pos) {
+    value(pos).~value_type();
+    setControl(pos, SwissControl::DELETED);
+    --size;
+    ++deleted;
+    return next(pos);
+  }
+
+  // tracked stays valid as it is
+  position eraseAndAdvance(position pos, position&) {
+    return eraseAndAdvance(pos);
+  }
+
+  // the entry is gone before the table shrinks, so a shrink that fails is skipped rather than
+  // reported; the table keeps its slots and erase does not throw
+  void erase(position pos) {
+    eraseAndAdvance(pos);
+    try {
+      shrinkIfNeeded();
+    }
+    catch(...) {
+    }
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_SWISSSTORAGE_H */
@@ -1,10 +1,15 @@
 #ifndef AISDI_MAPS_TREEMAP_H
 #define AISDI_MAPS_TREEMAP_H
 
+#include <algorithm>
 #include <cstddef>
 #include <initializer_list>
+#include <iterator>
 #include <stdexcept>
 #include <utility>
+#include <vector>
+
+#include "RedBlackTree.h"
 
 namespace aisdi
 {
@@ -24,100 +29,154 @@ public:
   class Iterator;
   using iterator = Iterator;
   using const_iterator = ConstIterator;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
-protected:
-  struct Node {
-    Node* left;
-    Node* right;
-    Node* parent;
+  // a pair of iterators usable in a range-based for
+  template <typename It>
+  class Range
+  {
+    It first;
+    It last;
 
-    value_type data;
+  public:
+    Range(It first, It last) : first(first), last(last) {}
+
+    It begin() const {
+      return first;
+    }
+
+    It end() const {
+      return last;
+    }
 
-    Node(const value_type& d, Node* p, Node* l, Node* r) :  left(l), right(r), parent(p), data(d) {}
+    bool isEmpty() const {
+      return first == last;
+    }
   };
 
-  Node* root;
-  unsigned treeSize;
+protected:
+  struct Node : RedBlackLinks {
+    value_type data;
+
+    explicit Node(const value_type& d) : RedBlackLinks(), data(d) {}
+  };
 
+  RedBlackTree tree;
+  size_type treeSize;
 
+  static Node* asNode(RedBlackLinks* links) {
+    return static_cast<Node*>(links);
+  }
 
-  void clearTree(Node* node) {
+  void clearTree(RedBlackLinks* node) {
     if(node->left)
       clearTree(node->left);
     if(node->right)
       clearTree(node->right);
     --treeSize;
-    delete node;
-
-    return;
+    delete asNode(node);
+  }
+
+  // the node holding key, or null with parent and asLeft set to where such a node would be linked
+  Node* findNode(const key_type& key, RedBlackLinks*& parent, bool& asLeft) const {
+    parent = nullptr;
+    asLeft = false;
+    RedBlackLinks* node = tree.getRoot();
+    while(node) {
+      const key_type& nodeKey = asNode(node)->data.first;
+      if(key < nodeKey)
+        asLeft = true;
+      else if(nodeKey < key)
+        asLeft = false;
+      else
+        return asNode(node);
+      parent = node;
+      node = asLeft ? node->left : node->right;
+    }
+    return nullptr;
   }
 
-  void copyTree(TreeMap* to, Node* from) {
-    to->insert(from->data);
-    if(from->left)
-      copyTree(to, from->left);
-    if(from->right)
-      copyTree(to, from->right);
-    return;
+  Node* findNode(const key_type& key) const {
+    RedBlackLinks* parent;
+    bool asLeft;
+    return findNode(key, parent, asLeft);
   }
 
-  iterator insert(const_reference entry) {
-
-    Node *tmp = root;
-      while(tmp) {
-        if(tmp->data.first > entry.first) {
-          if(!tmp->left) { //nie ma lewego dziecka
-            tmp->left = new Node(entry, tmp, nullptr, nullptr);
-            ++treeSize;
-            return iterator(this, tmp->left);
-          }
-          tmp = tmp->left;
-          continue; //przejscie do kolejnej petli while
-        }
-
-        if(tmp->data.first < entry.first) {
-          if(!tmp->right) { // nie ma prawego dziecka
-            tmp->right = new Node(entry, tmp, nullptr, nullptr);
-            ++treeSize;
-            return iterator(this, tmp->right);
-          }
-          tmp = tmp->right;
-          continue; //przejscie do kolejnej petli while
-        }
-        //drzewo zawiera juz element o danym kluczu
-        return iterator(this, tmp);
+  // the first node whose key is not less than key, or null
+  Node* lowerBoundNode(const key_type& key) const {
+    Node* bound = nullptr;
+    RedBlackLinks* node = tree.getRoot();
+    while(node) {
+      if(asNode(node)->data.first < key)
+        node = node->right;
+      else {
+        bound = asNode(node);
+        node = node->left;
+      }
+    }
+    return bound;
+  }
 
+  // the node with index entries before it in order, or null past the last one
+  Node* nthNode(size_type index) const {
+    RedBlackLinks* node = tree.getRoot();
+    while(node) {
+      size_type before = RedBlackTree::sizeOf(node->left);
+      if(index < before)
+        node = node->left;
+      else if(index == before)
+        return asNode(node);
+      else {
+        index -= before + 1;
+        node = node->right;
       }
+    }
+    return nullptr;
+  }
 
-      //drzewo jest puste
-      ++treeSize;
-      root = new Node(entry, nullptr, nullptr, nullptr);
-      return iterator(this, root);
+  // the first node whose key is greater than key, or null
+  Node* upperBoundNode(const key_type& key) const {
+    Node* bound = nullptr;
+    RedBlackLinks* node = tree.getRoot();
+    while(node) {
+      if(key < asNode(node)->data.first) {
+        bound = asNode(node);
+        node = node->left;
+      }
+      else
+        node = node->right;
+    }
+    return bound;
   }
 
+  // the tree is rebalanced after linking, so sorted input no longer degenerates into a list
+  iterator insert(const_reference entry) {
+    RedBlackLinks* parent;
+    bool asLeft;
+    Node* found = findNode(entry.first, parent, asLeft);
+    if(found)
+      return iterator(this, found);
+
+    Node* node = new Node(entry);
+    tree.insertAt(parent, asLeft, node);
+    ++treeSize;
+    return iterator(this, node);
+  }
 
+  // both ends are cached by the tree, so begin() and stepping back from end() need no descent
   Node* mostLeft() const {
-        if(isEmpty())
-        return nullptr;
-        Node* tmp=root;
-        while(tmp->left)
-            tmp=tmp->left;
-        return tmp;
+    return asNode(tree.getLeftmost());
   }
 
   Node* mostRight() const {
-  if(isEmpty())
-        return nullptr;
-        Node* tmp=root;
-        while(tmp->right)
-            tmp=tmp->right;
-        return tmp;
+    return asNode(tree.getRightmost());
   }
 
 
 public:
 
-  TreeMap() : root(nullptr), treeSize(0) {}
+  TreeMap() : tree(), treeSize(0) {}
 
   TreeMap(std::initializer_list<value_type> list) : TreeMap() {
     for(auto it = list.begin(); it!= list.end(); ++it) {
@@ -125,32 +184,21 @@ public:
     }
   }
 
+  // other is already in order, so the copy is a bulk load
   TreeMap(const TreeMap& other) : TreeMap() {
-    if(!other.isEmpty())
-      copyTree(this, other.root);
+    assign_sorted(other.cbegin(), other.cend());
   }
 
-  TreeMap(TreeMap&& other) {
-    root = other.root;
-    treeSize = other.treeSize;
-
+  TreeMap(TreeMap&& other) : tree(other.tree), treeSize(other.treeSize) {
+    other.tree.reset();
     other.treeSize = 0;
-    other.root = nullptr;
   }
 
   TreeMap& operator=(const TreeMap& other) {
     if(this == &other)
       return *this;
 
-    if(!isEmpty()) {
-      clearTree(root);
-      root = nullptr;
-      treeSize = 0;
-    }
-
-    if(!other.isEmpty())
-      copyTree(this, other.root);
-
+    assign_sorted(other.cbegin(), other.cend());
     return *this;
   }
 
@@ -158,24 +206,75 @@ public:
     if(this == &other)
       return *this;
 
-    clearTree(root);
+    if(!isEmpty())
+      clearTree(tree.getRoot());
 
-    root = other.root;
+    tree = other.tree;
     treeSize = other.treeSize;
 
     other.treeSize = 0;
-    other.root = nullptr;
+    other.tree.reset();
 
     return *this;
   }
 
   ~TreeMap() {
     if(!isEmpty())
-      clearTree(root);
+      clearTree(tree.getRoot());
+  }
+
+  // A perfectly balanced map of entries whose keys are strictly ascending, built in O(n) without a
+  // single key comparison; the order is trusted, not checked. Needs forward iterators.
+  template <typename ForwardIt>
+  static TreeMap from_sorted(ForwardIt first, ForwardIt last) {
+    TreeMap map;
+    map.assign_sorted(first, last);
+    return map;
+  }
+
+  // sorts a copy of the entries first; of repeated keys the first one is kept, as insert does
+  template <typename InputIt>
+  static TreeMap from_unsorted(InputIt first, InputIt last) {
+    TreeMap map;
+    map.assign_unsorted(first, last);
+    return map;
+  }
+
+  // replaces the contents the way from_sorted builds them; if copying an entry throws, the map is
+  // left as it was
+  template <typename ForwardIt>
+  void assign_sorted(ForwardIt first, ForwardIt last) {
+    std::vector<RedBlackLinks*> nodes;
+    nodes.reserve(static_cast<size_type>(std::distance(first, last)));
+    try {
+      for(; first != last; ++first)
+        nodes.push_back(new Node(*first));
+    }
+    catch(...) {
+      for(RedBlackLinks* node : nodes)
+        delete asNode(node);
+      throw;
+    }
+
+    if(!isEmpty())
+      clearTree(tree.getRoot());
+    tree.assignBalanced(nodes.data(), nodes.size());
+    treeSize = nodes.size();
+  }
+
+  template <typename InputIt>
+  void assign_unsorted(InputIt first, InputIt last) {
+    using entry_type = std::pair<key_type, mapped_type>;
+    std::vector<entry_type> entries(first, last);
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const entry_type& a, const entry_type& b) { return a.first < b.first; });
+    auto unique = std::unique(entries.begin(), entries.end(),
+                              [](const entry_type& a, const entry_type& b) { return !(a.first < b.first); });
+    assign_sorted(entries.begin(), unique);
   }
 
   bool isEmpty() const {
-    return !root;
+    return tree.isEmpty();
   }
 
   mapped_type& operator[](const key_type& key) {
@@ -183,7 +282,7 @@ public:
     if(tmp != end())
       return tmp->second;
     else {
-      iterator it = insert(value_type(key, std::string{}));
+      iterator it = insert(value_type(key, mapped_type{}));
       return it->second;
     }
   }
@@ -207,31 +306,99 @@ public:
   }
 
   const_iterator find(const key_type& key) const {
-    Node *tmp = root;
-    while(tmp) {
-      if(tmp->data.first > key)
-        tmp = tmp->left;
-      else if(tmp->data.first < key)
-        tmp = tmp->right;
-      else //znaleziono
-        return const_iterator(this, tmp);
-    }
-    //nie znaleziono
-    return cend();
+    return const_iterator(this, findNode(key));
   }
 
   iterator find(const key_type& key) {
-    Node *tmp = root;
-    while(tmp) {
-      if(tmp->data.first > key)
-        tmp = tmp->left;
-      else if(tmp->data.first < key)
-        tmp = tmp->right;
-      else //znaleziono
-        return iterator(this, tmp);
+    return iterator(this, findNode(key));
+  }
+
+  const_iterator lower_bound(const key_type& key) const {
+    return const_iterator(this, lowerBoundNode(key));
+  }
+
+  iterator lower_bound(const key_type& key) {
+    return iterator(this, lowerBoundNode(key));
+  }
+
+  const_iterator upper_bound(const key_type& key) const {
+    return const_iterator(this, upperBoundNode(key));
+  }
+
+  iterator upper_bound(const key_type& key) {
+    return iterator(this, upperBoundNode(key));
+  }
+
+  // the entry of key as a range of zero or one items
+  std::pair<const_iterator, const_iterator> equal_range(const key_type& key) const {
+    const_iterator first = lower_bound(key);
+    if(first == cend() || key < first->first)
+      return std::make_pair(first, first);
+    const_iterator last = first;
+    return std::make_pair(first, ++last);
+  }
+
+  std::pair<iterator, iterator> equal_range(const key_type& key) {
+    std::pair<const_iterator, const_iterator> found = static_cast<const TreeMap*>(this)->equal_range(key);
+    return std::make_pair(iterator(found.first), iterator(found.second));
+  }
+
+  // entries with keys from low up to, but not including, high; empty when high is not above low.
+  // Finding the ends costs two descents, after which every step is amortized O(1).
+  Range<const_iterator> range(const key_type& low, const key_type& high) const {
+    if(!(low < high))
+      return Range<const_iterator>(cend(), cend());
+    return Range<const_iterator>(lower_bound(low), lower_bound(high));
+  }
+
+  Range<iterator> range(const key_type& low, const key_type& high) {
+    if(!(low < high))
+      return Range<iterator>(end(), end());
+    return Range<iterator>(lower_bound(low), lower_bound(high));
+  }
+
+  // number of keys less than key; like nth, select and count it takes a descent or two over the
+  // subtree sizes the tree keeps in every node
+  size_type rank(const key_type& key) const {
+    size_type result = 0;
+    RedBlackLinks* node = tree.getRoot();
+    while(node) {
+      if(asNode(node)->data.first < key) {
+        result += RedBlackTree::sizeOf(node->left) + 1;
+        node = node->right;
+      }
+      else
+        node = node->left;
     }
-    //nie znaleziono
-    return end();
+    return result;
+  }
+
+  // the entry with index others before it, or end() when index is not below getSize()
+  const_iterator nth(size_type index) const {
+    return const_iterator(this, nthNode(index));
+  }
+
+  iterator nth(size_type index) {
+    return iterator(this, nthNode(index));
+  }
+
+  const_reference select(size_type index) const {
+    if(index >= treeSize)
+      throw std::out_of_range("Select index past the end of tree map");
+    return nthNode(index)->data;
+  }
+
+  reference select(size_type index) {
+    if(index >= treeSize)
+      throw std::out_of_range("Select index past the end of tree map");
+    return nthNode(index)->data;
+  }
+
+  // number of keys from low up to, but not including, high, the keys range(low, high) visits
+  size_type count(const key_type& low, const key_type& high) const {
+    if(!(low < high))
+      return 0;
+    return rank(high) - rank(low);
   }
 
   void remove(const key_type& key) {
@@ -250,75 +417,10 @@ public:
     if(it == end())
       throw std::out_of_range("Attempt to remove end iterator");
 
-    Node *toDel = it.node;
-
-    if(toDel->left == nullptr && toDel->right == nullptr) { //nie ma dzieci
-      if(toDel->parent != nullptr) { //jesli ma rodzica
-        if(toDel->parent->left == toDel)  //jezeli jest lewym dzieckiem
-          toDel->parent->left = nullptr;
-        else  //jezeli jest prawym dzieckiem
-          toDel->parent->right = nullptr;
-      }
-      else //jezeli nie ma rodzica, to znaczy ze usuwamy roota
-        root = nullptr;
-    }
-    else if(toDel->left == nullptr) { // ma prawe dziecko
-      if(toDel->parent != nullptr) { //jezeli ma rodzica
-        if(toDel->parent->left == toDel)  //jezeli jest lewym dzieckiem
-          toDel->parent->left = toDel->right;
-        else //jezeli jest prawym dzieckiem
-          toDel->parent->right = toDel->right;
-      }
-      else //jezeli nie ma rodzica, to znaczy ze usuwamy roota
-        root = toDel->right;
-
-      toDel->right->parent = toDel->parent;
-    }
-    else if(toDel->right == nullptr) { // ma lewe dziecko
-      if(toDel->parent != nullptr) { //jezeli ma rodzica
-        if(toDel->parent->left == toDel) //jezeli jest lewym dzieckiem
-          toDel->parent->left = toDel->left;
-        else  //jezeli jest prawym dzieckiem
-          toDel->parent->right = toDel->left;
-      }
-      else //jezeli nie ma rodzica, czyli usuwamy roota
-        root = toDel->left;
-
-      toDel->left->parent = toDel->parent;
-    }
-    else { // ma dwoje dzieci
-      Node* succ = toDel;
-      succ = succ->right;
-      while(succ->left != nullptr) //przejscie do najmniejszego elementu wiekszego od elementu do usuniecia
-        succ = succ->left;
-      //przepinanie wezlow
-      if(succ != toDel->right) {
-        succ->parent->left = succ->right;
-
-        if(succ->right)
-          succ->right->parent = succ->parent;
-
-        succ->right = toDel->right;
-        succ->right->parent = succ;
-      }
-
-      succ->left = toDel->left;
-      succ->left->parent = succ;
-
-      succ->parent = toDel->parent;
-
-      if(toDel->parent != nullptr) { //ma rodzica
-        if(toDel->parent->left == toDel) //jest lewym dzieckiem
-          toDel->parent->left = succ;
-        else //jest prawym dzieckiem
-          toDel->parent->right = succ;
-      }
-      else //usuwamy roota
-        root = succ;
-    }
-
+    // the red-black tree relinks the successor in place of a node with two children and rebalances
+    tree.erase(it.node);
     --treeSize;
-    delete toDel;
+    delete it.node;
   }
 
   size_type getSize() const {
@@ -348,8 +450,6 @@ public:
   }
 
   iterator begin() {
-    if(isEmpty())
-      return end();
     return iterator(this, mostLeft());
   }
 
@@ -358,8 +458,6 @@ public:
   }
 
   const_iterator cbegin() const {
-    if(isEmpty())
-      return cend();
     return const_iterator(this, mostLeft());
   }
 
@@ -374,6 +472,30 @@ public:
   const_iterator end() const {
     return cend();
   }
+
+  reverse_iterator rbegin() {
+    return reverse_iterator(end());
+  }
+
+  reverse_iterator rend() {
+    return reverse_iterator(begin());
+  }
+
+  const_reverse_iterator crbegin() const {
+    return const_reverse_iterator(cend());
+  }
+
+  const_reverse_iterator crend() const {
+    return const_reverse_iterator(cbegin());
+  }
+
+  const_reverse_iterator rbegin() const {
+    return crbegin();
+  }
+
+  const_reverse_iterator rend() const {
+    return crend();
+  }
 };
 
 template <typename KeyType, typename ValueType>
@@ -384,6 +506,7 @@ public:
   using iterator_category = std::bidirectional_iterator_tag;
   using value_type = typename TreeMap::value_type;
   using pointer = const typename TreeMap::value_type*;
+  using difference_type = std::ptrdiff_t;
 
 protected:
 
@@ -406,26 +529,7 @@ public:
     if(node == nullptr)
       throw std::out_of_range("Attempt to increment end iterator");
 
-    if(node == tree->mostRight()) {
-      node = nullptr; //teraz jest to iterator end
-      return *this;
-    }
-
-    if(node->right) { //jesli nie jestesmy w lisciu
-      node = node->right;
-      while(node->left) //szukamy nastepnika
-        node = node->left;
-      return *this;
-    }
-
-    if(node->parent->left == node)  //jesli jestemy w lewym dziecku
-      node = node->parent;
-    else { //jestesmy w prawym dziecku
-      while(node->parent->right == node)
-        node = node->parent;
-      node = node->parent;
-    }
-
+    node = asNode(RedBlackTree::next(node));
     return *this;
   }
 
@@ -444,20 +548,7 @@ public:
       return *this;
     }
 
-    if(node->left) { //jesli nie jestesmy w lisciu
-      node = node->left;
-      while(node->right) //szukamy poprzednika
-        node = node->right;
-      return *this;
-    }
-
-    if(node->parent->right == node) //jesli jestesmy w prawym lisciu
-      node = node->parent;
-    else { //jesli jestesmy w lewym lisciu
-      while(node->parent->left == node)
-        node = node->parent;
-      node = node->parent;
-    }
+    node = asNode(RedBlackTree::prev(node));
     return *this;
   }
 
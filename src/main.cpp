@@ -1,3 +1,4 @@
+#include <cerrno>
 #include <cstddef>
 #include <cstdlib>
 #include <string>
@@ -5,9 +6,21 @@
 #include <chrono>
 #include <ctime>
 #include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
 
 #include "TreeMap.h"
+#include "BPlusTreeMap.h"
 #include "HashMap.h"
+#include "MappedHashMap.h"
+#include "ConcurrentHashMap.h"
+#include "ReadMostlyHashMap.h"
 
 namespace
 {
@@ -17,83 +30,328 @@ template <typename K, typename V>
 using HashMap = aisdi::HashMap<K, V>;
 
 template <typename K, typename V>
-using TreeMap = aisdi::TreeMap<K, V>;
+using RobinHoodHashMap = aisdi::RobinHoodHashMap<K, V>;
 
-void perfomTest()
-{
-  std::chrono::time_point<std::chrono::system_clock> start, end;
-  std::chrono::duration<double> timeDifference;
+template <typename K, typename V>
+using SwissHashMap = aisdi::SwissHashMap<K, V>;
 
-  HashMap<int, std::string> hashMap;
-  TreeMap<int, std::string> treeMap;
-  const int size_n = 100000;
-  int elementsToInsert[size_n];
-  int elementsToRemove[size_n];
+template <typename K, typename V>
+using SmallHashMap = aisdi::SmallHashMap<K, V>;
 
-  for(int i = 0; i<size_n; ++i)
-    elementsToInsert[i] = i;
+template <typename K, typename V>
+using TreeMap = aisdi::TreeMap<K, V>;
 
-  for(int i = 0; i<size_n; ++i)
-    elementsToRemove[i] = i;
+template <typename K, typename V>
+using BPlusTreeMap = aisdi::BPlusTreeMap<K, V>;
 
-  std::random_shuffle(std::begin(elementsToInsert), std::end(elementsToInsert));
-  std::random_shuffle(std::begin(elementsToRemove), std::end(elementsToRemove));
+// the single global mutex the concurrent maps are measured against
+class LockedHashMap
+{
+  mutable std::mutex mutex;
+  HashMap<int, int> map;
+
+public:
+  bool insert_or_assign(int key, int value)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return map.insert_or_assign(key, value).second;
+  }
 
-//  for(int i : elementsToInsert)
-//    std::cout << " " << i;
-//  std::cout  << std::endl;
-//  for(int r : elementsToRemove)
-//    std::cout << " " << r;
-//  std::cout  << std::endl;
-  //==================================================================
-  //        HASHMAP
-  //==================================================================
+  bool find(int key, int& result) const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = map.find(key);
+    if(it == map.end())
+      return false;
+    result = it->second;
+    return true;
+  }
+};
+
+template <typename Map>
+void benchmarkMap(const std::string& name, const int* elementsToInsert, const int* elementsToRemove, int size_n)
+{
+  std::chrono::time_point<std::chrono::system_clock> start, end;
+  std::chrono::duration<double> timeDifference;
+  Map map;
 
   start = std::chrono::system_clock::now();
   for(int i = 0; i < size_n; ++i)
-    hashMap[elementsToInsert[i]] = "Test operator []";
+    map[elementsToInsert[i]] = "Test operator []";
   end = std::chrono::system_clock::now();
   timeDifference = end - start;
-  std::cout << "HashMap: adding " << size_n << " elements:   " << timeDifference.count() << std::endl;
+  std::cout << name << ": adding " << size_n << " elements:   " << timeDifference.count() << std::endl;
 
   start = std::chrono::system_clock::now();
   for(int i = 0; i < size_n; ++i)
-    hashMap.find(elementsToRemove[i]);
+    map.find(elementsToRemove[i]);
   end = std::chrono::system_clock::now();
   timeDifference = end - start;
-  std::cout << "HashMap: find " << size_n << " elements:     " << timeDifference.count() << std::endl;
+  std::cout << name << ": find " << size_n << " elements:     " << timeDifference.count() << std::endl;
 
   start = std::chrono::system_clock::now();
   for(int i = 0; i < size_n; ++i)
-    hashMap.remove(elementsToRemove[i]);
+    map.remove(elementsToRemove[i]);
   end = std::chrono::system_clock::now();
   timeDifference = end - start;
-  std::cout << "HashMap: remove " << size_n << " elements:   " << timeDifference.count() << std::endl << std::endl;
+  std::cout << name << ": remove " << size_n << " elements:   " << timeDifference.count() << std::endl << std::endl;
+}
 
-  //====================================================================
-  //        TREEMAP
-  //====================================================================
+// every thread does 99 lookups per update; prints throughput for 1, 2, 4... threads
+template <typename Map>
+void benchmarkConcurrentMap(const std::string& name, Map& map, int size_n)
+{
+  for(int i = 0; i < size_n; ++i)
+    map.insert_or_assign(i, i);
 
-  start = std::chrono::system_clock::now();
+  const int operationsPerThread = size_n * 10;
+  const unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  for(unsigned threadCount = 1; threadCount <= maxThreads; threadCount *= 2) {
+    std::vector<std::thread> threads;
+    std::vector<long> hits(threadCount);
+    auto start = std::chrono::steady_clock::now();
+    for(unsigned t = 0; t < threadCount; ++t)
+      threads.emplace_back([&map, &hits, t, size_n, operationsPerThread]() {
+        long found = 0;
+        int value;
+        for(int i = 0; i < operationsPerThread; ++i) {
+          int key = static_cast<int>((i * 7919L + t * 104729L) % size_n);
+          if(i % 100 == 0)
+            map.insert_or_assign(key, i);
+          else
+            found += map.find(key, value);
+        }
+        hits[t] = found;
+      });
+    for(auto& thread : threads)
+      thread.join();
+    std::chrono::duration<double> timeDifference = std::chrono::steady_clock::now() - start;
+
+    long totalHits = 0;
+    for(long h : hits)
+      totalHits += h;
+    double operations = static_cast<double>(operationsPerThread) * threadCount;
+    std::cout << name << ": " << threadCount << " threads, " << operations / timeDifference.count() / 1e6
+              << " Mops/s (" << totalHits << " hits)" << std::endl;
+  }
+  std::cout << std::endl;
+}
+
+// a find per key against contains_batch over blocks of the same keys, the best of a few runs each;
+// the map has to be far bigger than the caches for the batch to gain from having the misses of
+// several keys in flight at once
+template <typename Map>
+void benchmarkBatchLookup(const std::string& name, int size_n)
+{
+  Map map;
+  map.reserve(size_n);
   for(int i = 0; i < size_n; ++i)
-    treeMap[elementsToInsert[i]] = "Test operator []";
-  end = std::chrono::system_clock::now();
-  timeDifference = end - start;
-  std::cout << "TreeMap: adding " << size_n << " elements:   " << timeDifference.count() << std::endl;
+    map[i * 7] = i;
 
-  start = std::chrono::system_clock::now();
+  // every eighth key is missing
+  std::vector<int> keys(size_n);
   for(int i = 0; i < size_n; ++i)
-    treeMap.find(elementsToRemove[i]);
-  end = std::chrono::system_clock::now();
-  timeDifference = end - start;
-  std::cout << "TreeMap: find " << size_n << " elements:     " << timeDifference.count() << std::endl;
+    keys[i] = static_cast<int>((i * 7919L) % size_n) * 7 + (i % 8 == 0);
 
-  start = std::chrono::system_clock::now();
+  const int runs = 3;
+  const int block = 256;
+  std::unique_ptr<bool[]> found(new bool[block]);
+  double oneByOne = 0, batched = 0;
+  long hits = 0, batchHits = 0;
+  for(int run = 0; run < runs; ++run) {
+    auto start = std::chrono::steady_clock::now();
+    hits = 0;
+    for(int key : keys)
+      hits += map.find(key) != map.end();
+    std::chrono::duration<double> timeDifference = std::chrono::steady_clock::now() - start;
+    oneByOne = run ? std::min(oneByOne, timeDifference.count()) : timeDifference.count();
+
+    start = std::chrono::steady_clock::now();
+    batchHits = 0;
+    for(int first = 0; first < size_n; first += block) {
+      int count = std::min(block, size_n - first);
+      map.contains_batch(keys.data() + first, count, found.get());
+      for(int i = 0; i < count; ++i)
+        batchHits += found[i];
+    }
+    timeDifference = std::chrono::steady_clock::now() - start;
+    batched = run ? std::min(batched, timeDifference.count()) : timeDifference.count();
+  }
+  std::cout << name << ": find " << size_n << " keys one by one: " << oneByOne
+            << " (" << hits << " hits)" << std::endl;
+  std::cout << name << ": find " << size_n << " keys in batches: " << batched
+            << " (" << batchHits << " hits)" << std::endl << std::endl;
+}
+
+void perfomBatchTest()
+{
+  const int size_n = 1 << 23;
+
+  benchmarkBatchLookup<HashMap<int, int>>("HashMap", size_n);
+  benchmarkBatchLookup<RobinHoodHashMap<int, int>>("RobinHoodHashMap", size_n);
+  benchmarkBatchLookup<SwissHashMap<int, int>>("SwissHashMap", size_n);
+}
+
+// many maps of a few entries each, built and then searched for present and missing keys
+template <typename Map>
+void benchmarkSmallMaps(const std::string& name, int mapCount, int mapSize)
+{
+  auto start = std::chrono::steady_clock::now();
+  std::vector<Map> maps(mapCount);
+  for(int m = 0; m < mapCount; ++m)
+    for(int i = 0; i < mapSize; ++i)
+      maps[m][i * 7 + m] = i;
+  std::chrono::duration<double> timeDifference = std::chrono::steady_clock::now() - start;
+  std::cout << name << ": building " << mapCount << " maps of " << mapSize << ": " << timeDifference.count()
+            << std::endl;
+
+  start = std::chrono::steady_clock::now();
+  long hits = 0;
+  for(int m = 0; m < mapCount; ++m)
+    for(int i = 0; i < 2 * mapSize; ++i)
+      hits += maps[m].find(i * 7 + m) != maps[m].end();
+  timeDifference = std::chrono::steady_clock::now() - start;
+  std::cout << name << ": find in " << mapCount << " maps of " << mapSize << ":  " << timeDifference.count()
+            << " (" << hits << " hits)" << std::endl;
+}
+
+void perfomSmallMapTest()
+{
+  benchmarkSmallMaps<HashMap<int, int>>("HashMap", 100000, 8);
+  benchmarkSmallMaps<SmallHashMap<int, int>>("SmallHashMap", 100000, 8);
+  std::cout << std::endl;
+}
+
+// a new empty file under TMPDIR, or /tmp, made by mkstemp so no file of the user is overwritten;
+// the caller removes it
+std::string temporaryPath(const std::string& name)
+{
+  const char* dir = std::getenv("TMPDIR");
+  std::string path = std::string(dir && *dir ? dir : "/tmp") + "/" + name + ".XXXXXX";
+  int fd = mkstemp(&path[0]);
+  if(fd < 0)
+    throw std::system_error(errno, std::generic_category(), "cannot create " + path);
+  close(fd);
+  return path;
+}
+
+// rebuilding a map entry by entry against saving it once and mapping the image
+void perfomSnapshotTest()
+{
+  const int size_n = 1 << 20;
+  const std::string path = temporaryPath("aisdiMaps.snapshot");
+
+  auto start = std::chrono::steady_clock::now();
+  HashMap<int, int> map;
   for(int i = 0; i < size_n; ++i)
-    treeMap.remove(elementsToRemove[i]);
-  end = std::chrono::system_clock::now();
-  timeDifference = end - start;
-  std::cout << "TreeMap: remove " << size_n << " elements:   " << timeDifference.count() << std::endl << std::endl;
+    map[i * 7] = i;
+  std::chrono::duration<double> timeDifference = std::chrono::steady_clock::now() - start;
+  std::cout << "HashMap: building " << size_n << " elements:   " << timeDifference.count() << std::endl;
+
+  start = std::chrono::steady_clock::now();
+  aisdi::save(map, path);
+  timeDifference = std::chrono::steady_clock::now() - start;
+  std::cout << "HashMap: saving " << size_n << " elements:     " << timeDifference.count() << std::endl;
+
+  start = std::chrono::steady_clock::now();
+  auto mapped = aisdi::MappedHashMap<int, int>::open(path, false);
+  timeDifference = std::chrono::steady_clock::now() - start;
+  std::cout << "MappedHashMap: opening " << size_n << " elements: " << timeDifference.count() << std::endl;
+
+  start = std::chrono::steady_clock::now();
+  long hits = 0;
+  for(int i = 0; i < size_n; ++i)
+    hits += mapped.contains(i * 7);
+  timeDifference = std::chrono::steady_clock::now() - start;
+  std::cout << "MappedHashMap: find " << size_n << " elements:    " << timeDifference.count()
+            << " (" << hits << " hits)" << std::endl << std::endl;
+  std::remove(path.c_str());
+}
+
+void perfomFreezeTest()
+{
+  const int size_n = 1 << 20;
+  HashMap<int, int> map;
+  for(int i = 0; i < size_n; ++i)
+    map[i * 7] = i;
+
+  auto start = std::chrono::steady_clock::now();
+  long hits = 0;
+  for(int i = 0; i < size_n; ++i)
+    hits += map.find(i * 7) != map.end();
+  std::chrono::duration<double> timeDifference = std::chrono::steady_clock::now() - start;
+  std::cout << "HashMap: find " << size_n << " elements:          " << timeDifference.count()
+            << " (" << map.stats().bytesUsed << " bytes)" << std::endl;
+
+  start = std::chrono::steady_clock::now();
+  auto frozen = map.freeze();
+  timeDifference = std::chrono::steady_clock::now() - start;
+  std::cout << "FrozenHashMap: freezing " << size_n << " elements: " << timeDifference.count() << std::endl;
+
+  start = std::chrono::steady_clock::now();
+  hits = 0;
+  for(int i = 0; i < size_n; ++i)
+    hits += frozen.contains(i * 7);
+  timeDifference = std::chrono::steady_clock::now() - start;
+  std::cout << "FrozenHashMap: find " << size_n << " elements:    " << timeDifference.count()
+            << " (" << frozen.getBytesUsed() << " bytes, " << hits << " hits)" << std::endl << std::endl;
+}
+
+void perfomScalingTest()
+{
+  const int size_n = 100000;
+
+  LockedHashMap locked;
+  benchmarkConcurrentMap("HashMap + mutex", locked, size_n);
+
+  aisdi::ConcurrentHashMap<int, int> concurrent;
+  benchmarkConcurrentMap("ConcurrentHashMap", concurrent, size_n);
+
+  aisdi::ReadMostlyHashMap<int, int> readMostly;
+  benchmarkConcurrentMap("ReadMostlyHashMap", readMostly, size_n);
+}
+
+// keys in ascending order, as from a timestamp or sequence feed
+void perfomSortedTest()
+{
+  const int size_n = 100000;
+  static int sortedElements[size_n];
+  for(int i = 0; i < size_n; ++i)
+    sortedElements[i] = i;
+
+  benchmarkMap<TreeMap<int, std::string>>("TreeMap (sorted keys)", sortedElements, sortedElements, size_n);
+  benchmarkMap<BPlusTreeMap<int, std::string>>("BPlusTreeMap (sorted keys)", sortedElements, sortedElements, size_n);
+
+  std::vector<std::pair<int, std::string>> entries;
+  for(int i = 0; i < size_n; ++i)
+    entries.emplace_back(sortedElements[i], "Test operator []");
+  auto start = std::chrono::system_clock::now();
+  auto map = TreeMap<int, std::string>::from_sorted(entries.begin(), entries.end());
+  std::chrono::duration<double> timeDifference = std::chrono::system_clock::now() - start;
+  std::cout << "TreeMap (sorted keys): bulk loading " << map.getSize() << " elements:   "
+            << timeDifference.count() << std::endl << std::endl;
+}
+
+void perfomTest()
+{
+  const int size_n = 100000;
+  static int elementsToInsert[size_n];
+  static int elementsToRemove[size_n];
+
+  for(int i = 0; i<size_n; ++i)
+    elementsToInsert[i] = i;
+
+  for(int i = 0; i<size_n; ++i)
+    elementsToRemove[i] = i;
+
+  std::random_shuffle(std::begin(elementsToInsert), std::end(elementsToInsert));
+  std::random_shuffle(std::begin(elementsToRemove), std::end(elementsToRemove));
+
+  benchmarkMap<HashMap<int, std::string>>("HashMap", elementsToInsert, elementsToRemove, size_n);
+  benchmarkMap<RobinHoodHashMap<int, std::string>>("RobinHoodHashMap", elementsToInsert, elementsToRemove, size_n);
+  benchmarkMap<SwissHashMap<int, std::string>>("SwissHashMap", elementsToInsert, elementsToRemove, size_n);
+  benchmarkMap<TreeMap<int, std::string>>("TreeMap", elementsToInsert, elementsToRemove, size_n);
+  benchmarkMap<BPlusTreeMap<int, std::string>>("BPlusTreeMap", elementsToInsert, elementsToRemove, size_n);
 }
 
 } // namespace
@@ -103,5 +361,11 @@ int main(int argc, char** argv)
   const std::size_t repeatCount = argc > 1 ? std::atoll(argv[1]) : 10;
   for (std::size_t i = 0; i < repeatCount; ++i)
     perfomTest();
+  perfomScalingTest();
+  perfomBatchTest();
+  perfomSnapshotTest();
+  perfomFreezeTest();
+  perfomSmallMapTest();
+  perfomSortedTest();
   return 0;
 }
@@ -0,0 +1,187 @@
+#include <BPlusTreeMap.h>
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+
+template <typename K>
+using Map = aisdi::BPlusTreeMap<K, std::string>;
+
+BOOST_AUTO_TEST_SUITE(BPlusTreeMapTests)
+
+template <typename Map, typename Expected>
+void thenMapContainsItems(const Map& map, const Expected& expected)
+{
+  BOOST_REQUIRE_EQUAL(map.getSize(), expected.size());
+  auto it = map.begin();
+  for (const auto& item : expected)
+  {
+    BOOST_REQUIRE(it != map.end());
+    BOOST_CHECK(*it == item);
+    ++it;
+  }
+  BOOST_CHECK(it == map.end());
+
+  for (auto expectedIt = expected.rbegin(); expectedIt != expected.rend(); ++expectedIt)
+  {
+    --it;
+    BOOST_CHECK(*it == *expectedIt);
+  }
+  BOOST_CHECK(it == map.begin());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenCreated_ThenItIsEmpty, K, TestedKeyTypes)
+{
+  const Map<K> map;
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK_EQUAL(map.getSize(), 0);
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK(map.find(42) == map.end());
+  BOOST_CHECK_THROW(map.valueOf(42), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenIncrementingOrDecrementingIterator_ThenOperationThrows,
+                              K, TestedKeyTypes)
+{
+  Map<K> map;
+
+  auto it = map.end();
+  BOOST_CHECK_THROW(++it, std::out_of_range);
+  BOOST_CHECK_THROW(--it, std::out_of_range);
+  BOOST_CHECK_THROW(*it, std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManyKeys_WhenInsertingThem_ThenTheyAreIteratedInOrder, K, TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (K i = 0; i < 5000; ++i)
+  {
+    const K key = (i * 7919) % 5000;
+    map[key] = std::to_string(key);
+    expected[key] = std::to_string(key);
+  }
+
+  thenMapContainsItems(map, expected);
+  for (const auto& item : expected)
+    BOOST_CHECK_EQUAL(map.valueOf(item.first), item.second);
+  BOOST_CHECK(map.find(5000) == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenExistingKey_WhenInsertingAgain_ThenValueIsKept, K, TestedKeyTypes)
+{
+  Map<K> map = {{1, "one"}, {2, "two"}};
+
+  map[1];
+  map[3] = "three";
+
+  BOOST_CHECK_EQUAL(map.getSize(), 3);
+  BOOST_CHECK_EQUAL(map.valueOf(1), "one");
+  BOOST_CHECK_EQUAL(map[3], "three");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManyKeys_WhenRemovingAll_ThenMapIsEmpty, K, TestedKeyTypes)
+{
+  Map<K> map;
+  for (K i = 0; i < 3000; ++i)
+    map[i] = std::to_string(i);
+
+  for (K i = 0; i < 3000; i += 2)
+    map.remove(i);
+  for (K i = 1; i < 3000; i += 2)
+    map.remove(map.find(i));
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  map[7] = "seven";
+  BOOST_CHECK_EQUAL(map.valueOf(7), "seven");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMissingKey_WhenRemoving_ThenOperationThrows, K, TestedKeyTypes)
+{
+  Map<K> map;
+  BOOST_CHECK_THROW(map.remove(1), std::out_of_range);
+  BOOST_CHECK_THROW(map.remove(map.end()), std::out_of_range);
+
+  map[1] = "one";
+  BOOST_CHECK_THROW(map.remove(2), std::out_of_range);
+  BOOST_CHECK_EQUAL(map.getSize(), 1);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenRandomOperations_WhenComparedWithStdMap_ThenContentsMatch, K, TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  std::mt19937 random(42);
+  std::uniform_int_distribution<int> keys(0, 4000);
+
+  for (int i = 0; i < 40000; ++i)
+  {
+    const K key = static_cast<K>(keys(random));
+    if (random() % 3)
+    {
+      map[key] = std::to_string(i);
+      expected[key] = std::to_string(i);
+    }
+    else if (expected.erase(key))
+      map.remove(key);
+    else
+      BOOST_CHECK_THROW(map.remove(key), std::out_of_range);
+  }
+
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenPopulatedMap_WhenCopyingAndMoving_ThenContentsAreKept, K, TestedKeyTypes)
+{
+  Map<K> map;
+  for (K i = 0; i < 2000; ++i)
+    map[i] = std::to_string(i);
+
+  Map<K> copy(map);
+  BOOST_CHECK(copy == map);
+  copy.remove(0);
+  copy[5000] = "new";
+  BOOST_CHECK(copy != map);
+  BOOST_CHECK_EQUAL(map.valueOf(0), "0");
+
+  Map<K> moved(std::move(copy));
+  BOOST_CHECK(copy.isEmpty());
+  BOOST_CHECK_EQUAL(moved.getSize(), 2000);
+  BOOST_CHECK_EQUAL(moved.valueOf(5000), "new");
+  BOOST_CHECK_EQUAL((--moved.end())->first, 5000);
+
+  copy = moved;
+  moved = std::move(map);
+  BOOST_CHECK_EQUAL(copy.valueOf(5000), "new");
+  BOOST_CHECK_EQUAL(moved.valueOf(0), "0");
+}
+
+BOOST_AUTO_TEST_CASE(GivenStringKeys_WhenInsertingAndRemoving_ThenTheyAreKeptInOrder)
+{
+  aisdi::BPlusTreeMap<std::string, int> map;
+  std::map<std::string, int> expected;
+  for (int i = 0; i < 3000; ++i)
+  {
+    map[std::to_string(i)] = i;
+    expected[std::to_string(i)] = i;
+  }
+  for (int i = 0; i < 3000; i += 3)
+  {
+    map.remove(std::to_string(i));
+    expected.erase(std::to_string(i));
+  }
+
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
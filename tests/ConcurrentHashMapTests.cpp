@@ -0,0 +1,161 @@
+#include <ConcurrentHashMap.h>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+using TestedStorages = boost::mpl::list<aisdi::ChainedStorage, aisdi::RobinHoodStorage, aisdi::SwissStorage>;
+
+template <typename S>
+using Map = aisdi::ConcurrentHashMap<std::uint64_t, std::uint64_t,
+                                     std::hash<std::uint64_t>, std::equal_to<std::uint64_t>, S>;
+
+namespace
+{
+
+const unsigned THREADS = 8;
+
+template <typename F>
+void runInThreads(F f)
+{
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < THREADS; ++t)
+    threads.emplace_back(f, t);
+  for (auto& thread : threads)
+    thread.join();
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(ConcurrentHashMapTests)
+
+BOOST_AUTO_TEST_CASE(GivenShardCount_WhenCreatingMap_ThenItIsRoundedUpToPowerOfTwo)
+{
+  BOOST_CHECK_EQUAL(Map<aisdi::ChainedStorage>(1).getShardCount(), 1);
+  BOOST_CHECK_EQUAL(Map<aisdi::ChainedStorage>(20).getShardCount(), 32);
+  BOOST_CHECK_EQUAL(Map<aisdi::ChainedStorage>().getShardCount(), 64);
+  BOOST_CHECK_THROW(Map<aisdi::ChainedStorage>(0), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(GivenEmptyMap_WhenUsingSingleThread_ThenItBehavesLikeHashMap)
+{
+  aisdi::ConcurrentHashMap<std::string, std::string> map(4);
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.insert_or_assign("Alice", "Bob"));
+  BOOST_CHECK(!map.insert_or_assign("Alice", "Chuck"));
+  BOOST_CHECK(map.try_emplace("Dave", 3, 'x'));
+  BOOST_CHECK(!map.try_emplace("Dave", "Eve"));
+
+  std::string value;
+  BOOST_CHECK(map.find("Alice", value));
+  BOOST_CHECK_EQUAL(value, "Chuck");
+  BOOST_CHECK(!map.find("Eve", value));
+  BOOST_CHECK_EQUAL(value, "Chuck");
+  BOOST_CHECK_EQUAL(map.valueOf("Dave"), "xxx");
+  BOOST_CHECK_THROW(map.valueOf("Eve"), std::out_of_range);
+  BOOST_CHECK_EQUAL(map.getSize(), 2);
+
+  BOOST_CHECK(map.remove("Alice"));
+  BOOST_CHECK(!map.remove("Alice"));
+  BOOST_CHECK(!map.contains("Alice"));
+  BOOST_CHECK(map.contains("Dave"));
+
+  map.clear();
+  BOOST_CHECK(map.isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(GivenMap_WhenComputing_ThenEntryIsUpdatedInsertedOrRemoved)
+{
+  Map<aisdi::ChainedStorage> map;
+  map.insert_or_assign(1, 10);
+
+  BOOST_CHECK(map.compute(1, [](std::uint64_t& value, bool present) { value += 5; return present; }));
+  BOOST_CHECK(map.compute(2, [](std::uint64_t& value, bool present) { value = present ? 0 : 7; return true; }));
+  BOOST_CHECK(!map.compute(3, [](std::uint64_t&, bool present) { return present; }));
+  BOOST_CHECK(!map.compute(1, [](std::uint64_t&, bool) { return false; }));
+  BOOST_CHECK_THROW(map.compute(4, [](std::uint64_t&, bool) -> bool { throw std::runtime_error("f"); }),
+                    std::runtime_error);
+
+  BOOST_CHECK_EQUAL(map.getSize(), 1);
+  BOOST_CHECK_EQUAL(map.valueOf(2), 7);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManyThreads_WhenInsertingDisjointKeys_ThenEveryKeyIsPresent,
+                              S,
+                              TestedStorages)
+{
+  const std::uint64_t perThread = 5000;
+  Map<S> map(16);
+
+  runInThreads([&](unsigned t) {
+    for (std::uint64_t i = 0; i < perThread; ++i)
+      map.insert_or_assign(t * perThread + i, i);
+  });
+
+  BOOST_CHECK_EQUAL(map.getSize(), THREADS * perThread);
+  std::map<std::uint64_t, std::uint64_t> contents;
+  map.forEach([&](std::uint64_t key, std::uint64_t value) { contents[key] = value; });
+  BOOST_REQUIRE_EQUAL(contents.size(), THREADS * perThread);
+  for (const auto& item : contents)
+    BOOST_CHECK_EQUAL(item.second, item.first % perThread);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManyThreads_WhenComputingSharedCounters_ThenNoIncrementIsLost,
+                              S,
+                              TestedStorages)
+{
+  const std::uint64_t counters = 37;
+  const std::uint64_t increments = 20000;
+  Map<S> map(4);
+
+  runInThreads([&](unsigned t) {
+    for (std::uint64_t i = 0; i < increments; ++i)
+      map.compute((i + t) % counters, [](std::uint64_t& value, bool) { ++value; return true; });
+  });
+
+  std::uint64_t total = 0;
+  map.forEach([&](std::uint64_t, std::uint64_t value) { total += value; });
+  BOOST_CHECK_EQUAL(map.getSize(), counters);
+  BOOST_CHECK_EQUAL(total, THREADS * increments);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManyThreads_WhenMixingReadsAndWrites_ThenReadersSeeConsistentValues,
+                              S,
+                              TestedStorages)
+{
+  const std::uint64_t keys = 1000;
+  Map<S> map(8);
+  bool consistent = true;
+  std::mutex resultMutex;
+
+  runInThreads([&](unsigned t) {
+    bool ok = true;
+    for (std::uint64_t round = 0; round < 20; ++round) {
+      for (std::uint64_t key = t; key < keys; key += THREADS) {
+        const std::uint64_t partner = key ^ 1;
+        if (t % 2 == 0)
+          map.insert_or_assign(key, key * 2);
+        else if (round % 3 == 2)
+          map.remove(partner);
+        std::uint64_t value;
+        if (map.find(partner, value))
+          ok = ok && value == partner * 2;
+      }
+    }
+    std::lock_guard<std::mutex> lock(resultMutex);
+    consistent = consistent && ok;
+  });
+
+  BOOST_CHECK(consistent);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,116 @@
+#include <HashMap.h>
+
+#include <cstddef>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+
+using Map = aisdi::HashMap<int, std::string>;
+
+struct ConstantHash
+{
+  std::size_t operator()(int) const
+  {
+    return 7;
+  }
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(FrozenHashMapTests)
+
+BOOST_AUTO_TEST_CASE(GivenPopulatedMap_WhenFreezing_ThenAllItemsCanBeFound)
+{
+  Map map;
+  for (int i = 0; i < 20000; ++i)
+    map[i * 7] = std::to_string(i);
+
+  const auto frozen = map.freeze();
+
+  BOOST_CHECK_EQUAL(frozen.getSize(), 20000);
+  for (int i = 0; i < 20000; ++i)
+  {
+    const auto it = frozen.find(i * 7);
+    BOOST_REQUIRE(it != frozen.end());
+    BOOST_CHECK_EQUAL(it->first, i * 7);
+    BOOST_CHECK_EQUAL(it->second, std::to_string(i));
+    BOOST_CHECK(!frozen.contains(i * 7 + 1));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenFrozenMap_WhenIterating_ThenEveryItemIsVisitedOnce)
+{
+  Map map;
+  for (int i = 0; i < 1000; ++i)
+    map[i] = std::to_string(i);
+
+  const auto frozen = map.freeze();
+  std::set<int> keys;
+  for (const auto& item : frozen)
+  {
+    BOOST_CHECK(keys.insert(item.first).second);
+    BOOST_CHECK_EQUAL(item.second, map.valueOf(item.first));
+  }
+
+  BOOST_CHECK_EQUAL(keys.size(), 1000);
+  const std::size_t bucketSize = aisdi::FrozenHashMap<int, std::string>::AVERAGE_BUCKET_SIZE;
+  BOOST_CHECK_EQUAL(frozen.getBucketCount(), (1000 + bucketSize - 1) / bucketSize);
+}
+
+BOOST_AUTO_TEST_CASE(GivenEmptyMap_WhenFreezing_ThenFrozenMapIsEmpty)
+{
+  const Map map;
+
+  const auto frozen = map.freeze();
+
+  BOOST_CHECK(frozen.isEmpty());
+  BOOST_CHECK(frozen.begin() == frozen.end());
+  BOOST_CHECK(frozen.find(42) == frozen.end());
+  BOOST_CHECK_THROW(frozen.valueOf(42), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(GivenFrozenMap_WhenChangingSourceMap_ThenFrozenMapStaysTheSame)
+{
+  Map map;
+  map[1] = "one";
+  map[2] = "two";
+
+  const auto frozen = map.freeze();
+  map[1] = "uno";
+  map.remove(2);
+
+  BOOST_CHECK_EQUAL(frozen.valueOf(1), "one");
+  BOOST_CHECK_EQUAL(frozen.valueOf(2), "two");
+  BOOST_CHECK_THROW(frozen.valueOf(3), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(GivenSeededMap_WhenFreezing_ThenSeedIsKept)
+{
+  Map map;
+  for (int i = 0; i < 100; ++i)
+    map[i] = std::to_string(i);
+  map.setHashSeed(0x5eed);
+
+  const auto frozen = map.freeze();
+
+  BOOST_CHECK_EQUAL(frozen.getHashSeed(), 0x5eed);
+  for (int i = 0; i < 100; ++i)
+    BOOST_CHECK_EQUAL(frozen.valueOf(i), std::to_string(i));
+}
+
+BOOST_AUTO_TEST_CASE(GivenKeysWithEqualHashes_WhenFreezing_ThenOperationThrows)
+{
+  aisdi::HashMap<int, int, ConstantHash> map;
+  map[1] = 1;
+  BOOST_CHECK_NO_THROW(map.freeze());
+
+  map[2] = 2;
+  BOOST_CHECK_THROW(map.freeze(), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,1012 @@
+#include <HashMap.h>
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <map>
+#include <type_traits>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+#ifdef AISDI_SWISS_SIMD
+using TestedStorages = boost::mpl::list<aisdi::ChainedStorage,
+                                        aisdi::RobinHoodStorage,
+                                        aisdi::SwissStorage,
+                                        aisdi::BasicSwissStorage<aisdi::SwissGroupScalar>,
+                                        aisdi::SmallStorage<>,
+                                        aisdi::SmallStorage<4, aisdi::RobinHoodStorage>>;
+// RobinHoodStorage requires entries that move without throwing
+using ThrowingMoveStorages = boost::mpl::list<aisdi::ChainedStorage,
+                                              aisdi::SwissStorage,
+                                              aisdi::BasicSwissStorage<aisdi::SwissGroupScalar>,
+                                              aisdi::SmallStorage<>>;
+#else
+using TestedStorages = boost::mpl::list<aisdi::ChainedStorage,
+                                        aisdi::RobinHoodStorage,
+                                        aisdi::SwissStorage,
+                                        aisdi::SmallStorage<>,
+                                        aisdi::SmallStorage<4, aisdi::RobinHoodStorage>>;
+using ThrowingMoveStorages = boost::mpl::list<aisdi::ChainedStorage,
+                                              aisdi::SwissStorage,
+                                              aisdi::SmallStorage<>>;
+#endif
+
+struct ConstantHash
+{
+  std::size_t operator()(std::uint64_t) const
+  {
+    return 42;
+  }
+};
+
+// a hash with state and no default constructor
+struct SeededHash
+{
+  explicit SeededHash(std::size_t seed) : seed(seed)
+  {}
+
+  std::size_t operator()(std::uint64_t key) const
+  {
+    return std::hash<std::uint64_t>()(key ^ seed);
+  }
+
+  std::size_t seed;
+};
+
+// a hash whose copy may throw, as one holding a table of its own could
+struct CopyThrowingHash
+{
+  CopyThrowingHash() = default;
+
+  CopyThrowingHash(const CopyThrowingHash&) noexcept(false)
+  {}
+
+  CopyThrowingHash& operator=(const CopyThrowingHash&) = default;
+
+  std::size_t operator()(std::uint64_t key) const
+  {
+    return std::hash<std::uint64_t>()(key);
+  }
+};
+
+template <typename S>
+using Map = aisdi::HashMap<std::uint64_t, std::string, std::hash<std::uint64_t>, std::equal_to<std::uint64_t>, S>;
+
+template <typename S>
+using CollidingMap = aisdi::HashMap<std::uint64_t, std::string, ConstantHash, std::equal_to<std::uint64_t>, S>;
+
+// fails for one key, as a hash of a key that cannot be read might
+struct ThrowingHash
+{
+  std::size_t operator()(std::uint64_t key) const
+  {
+    if (key == 13)
+      throw std::invalid_argument("unlucky key");
+    return std::hash<std::uint64_t>()(key);
+  }
+};
+
+// fails once callsLeft runs out, colliding every key when collide is set
+struct CountdownHash
+{
+  static int callsLeft;
+  static bool collide;
+
+  std::size_t operator()(std::uint64_t key) const
+  {
+    if (callsLeft-- == 0)
+      throw std::runtime_error("hash failed");
+    return collide ? 42 : std::hash<std::uint64_t>()(key);
+  }
+};
+
+int CountdownHash::callsLeft = -1;
+bool CountdownHash::collide = false;
+
+// a value whose move constructor throws once movesLeft runs out, and its copy once copiesLeft does
+struct ThrowingMove
+{
+  static int movesLeft;
+  static int copiesLeft;
+  int value;
+
+  ThrowingMove(int value = 0) : value(value)
+  {}
+
+  ThrowingMove(const ThrowingMove& other) : value(other.value)
+  {
+    if (copiesLeft-- == 0)
+      throw std::runtime_error("copy failed");
+  }
+
+  ThrowingMove(ThrowingMove&& other) : value(other.value)
+  {
+    if (movesLeft-- == 0)
+      throw std::runtime_error("move failed");
+  }
+
+  ThrowingMove& operator=(const ThrowingMove&) = default;
+};
+
+int ThrowingMove::movesLeft = -1;
+int ThrowingMove::copiesLeft = -1;
+
+using std::begin;
+using std::end;
+
+BOOST_AUTO_TEST_SUITE(HashMapStorageTests)
+
+template <typename S>
+void thenMapContainsItems(const Map<S>& map,
+                          const std::map<std::uint64_t, std::string>& expected)
+{
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+
+  for (const auto& item : expected)
+  {
+    const auto it = map.find(item.first);
+    BOOST_REQUIRE_MESSAGE(it != end(map), "Missing required item with key: " << item.first);
+    BOOST_CHECK_MESSAGE(it->second == item.second,
+                        "Wrong value in map for key: " << item.first
+                        << " (expected: \"" << item.second
+                        << "\" got: \"" << it->second << "\")");
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenAddingManyItems_ThenAllItemsAreInMap,
+                              S,
+                              TestedStorages)
+{
+  Map<S> map;
+  std::map<std::uint64_t, std::string> expected;
+
+  for (std::uint64_t i = 0; i < 20000; ++i)
+  {
+    map[i * 7919] = std::to_string(i);
+    expected[i * 7919] = std::to_string(i);
+  }
+
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK(map.find(1) == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenIteratingForwardAndBackward_ThenEveryItemIsVisitedOnce,
+                              S,
+                              TestedStorages)
+{
+  Map<S> map;
+  for (std::uint64_t i = 0; i < 1000; ++i)
+    map[i] = std::to_string(i);
+
+  std::map<std::uint64_t, int> visits;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    ++visits[it->first];
+  std::size_t backwardCount = 0;
+  for (auto it = map.end(); it != map.begin(); --it)
+    ++backwardCount;
+
+  BOOST_CHECK_EQUAL(visits.size(), 1000);
+  for (const auto& visit : visits)
+    BOOST_CHECK_EQUAL(visit.second, 1);
+  BOOST_CHECK_EQUAL(backwardCount, 1000);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenRandomInsertsAndRemovals_WhenComparingWithStdMap_ThenContentsMatch,
+                              S,
+                              TestedStorages)
+{
+  Map<S> map;
+  std::map<std::uint64_t, std::string> expected;
+  std::mt19937_64 random(2016);
+
+  for (int i = 0; i < 50000; ++i)
+  {
+    const std::uint64_t key = random() % 4096;
+    if (random() % 3 == 0 && expected.count(key))
+    {
+      map.remove(key);
+      expected.erase(key);
+    }
+    else
+    {
+      map[key] = std::to_string(i);
+      expected[key] = std::to_string(i);
+    }
+  }
+
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenRemovingAllItems_ThenMapIsEmptyAndReusable,
+                              S,
+                              TestedStorages)
+{
+  Map<S> map;
+  for (std::uint64_t i = 0; i < 5000; ++i)
+    map[i] = std::to_string(i);
+
+  for (std::uint64_t i = 0; i < 5000; ++i)
+    map.remove(i);
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+
+  map[42] = "Answer";
+  thenMapContainsItems(map, { { 42, "Answer" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenCopyingAndMoving_ThenItemsAreIndependent,
+                              S,
+                              TestedStorages)
+{
+  Map<S> map;
+  for (std::uint64_t i = 0; i < 100; ++i)
+    map[i] = std::to_string(i);
+
+  Map<S> copy{map};
+  map[7] = "Changed";
+  Map<S> moved{std::move(map)};
+
+  BOOST_CHECK_EQUAL(copy.valueOf(7), "7");
+  BOOST_CHECK_EQUAL(moved.valueOf(7), "Changed");
+  BOOST_CHECK_EQUAL(copy.getSize(), 100);
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK_EQUAL(map.getBucketCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenStatefulHash_WhenMovingMap_ThenNothingThrowsAndHashIsKept,
+                              S,
+                              TestedStorages)
+{
+  using SeededMap = aisdi::HashMap<std::uint64_t, std::string, SeededHash, std::equal_to<std::uint64_t>, S>;
+  static_assert(std::is_nothrow_move_constructible<Map<S>>::value, "moving a map must not throw");
+  static_assert(std::is_nothrow_move_assignable<Map<S>>::value, "moving a map must not throw");
+  static_assert(std::is_nothrow_move_constructible<SeededMap>::value, "moving a map must not throw");
+  static_assert(!std::is_nothrow_move_constructible<aisdi::HashMap<std::uint64_t, std::string, CopyThrowingHash,
+                                                                   std::equal_to<std::uint64_t>, S>>::value,
+                "moving a map copies its hasher");
+
+  SeededMap map{ SeededHash(7) };
+  for (std::uint64_t i = 0; i < 100; ++i)
+    map[i] = std::to_string(i);
+
+  SeededMap moved(std::move(map));
+  SeededMap assigned{ SeededHash(3) };
+  assigned = std::move(moved);
+
+  BOOST_CHECK_EQUAL(assigned.getHasher().seed, 7);
+  BOOST_CHECK_EQUAL(assigned.getSize(), 100);
+  BOOST_CHECK_EQUAL(assigned.valueOf(42), "42");
+  BOOST_CHECK(map.isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMapsWithDifferentCapacities_WhenComparingThem_ThenTheyAreEqual,
+                              S,
+                              TestedStorages)
+{
+  Map<S> map;
+  Map<S> other;
+  other.reserve(10000);
+  for (std::uint64_t i = 0; i < 100; ++i)
+  {
+    map[i] = std::to_string(i);
+    other[99 - i] = std::to_string(99 - i);
+  }
+
+  BOOST_CHECK(map == other);
+  other[5] = "Five";
+  BOOST_CHECK(map != other);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenAllKeysColliding_WhenAddingAndRemovingItems_ThenMapStaysCorrect,
+                              S,
+                              TestedStorages)
+{
+  CollidingMap<S> map;
+
+  for (std::uint64_t i = 0; i < 100; ++i)
+    map[i] = std::to_string(i);
+  for (std::uint64_t i = 0; i < 100; i += 2)
+    map.remove(i);
+
+  BOOST_CHECK_EQUAL(map.getSize(), 50);
+  for (std::uint64_t i = 0; i < 100; ++i)
+    BOOST_CHECK_EQUAL(map.find(i) != map.end(), i % 2 == 1);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenThousandsOfCollidingKeys_WhenAddingRemovingAndCopying_ThenMapMatchesStdMap,
+                              S,
+                              TestedStorages)
+{
+  CollidingMap<S> map;
+  std::map<std::uint64_t, std::string> expected;
+  for (std::uint64_t i = 0; i < 3000; ++i)
+  {
+    const std::uint64_t key = (i * 7919) % 3000;
+    map[key] = std::to_string(key);
+    expected[key] = std::to_string(key);
+  }
+  for (std::uint64_t i = 0; i < 3000; i += 3)
+  {
+    map.remove(i);
+    expected.erase(i);
+  }
+  const auto copy = map;
+
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+  for (std::uint64_t i = 0; i < 3000; ++i)
+    BOOST_CHECK_EQUAL(map.find(i) != map.end(), expected.count(i) == 1);
+  std::size_t visited = 0;
+  for (auto it = map.end(); it != map.begin(); ++visited)
+    --it;
+  BOOST_CHECK_EQUAL(visited, expected.size());
+  BOOST_CHECK(copy == map);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenClearing_ThenMapIsEmptyWithoutBucketsAndReusable,
+                              S,
+                              TestedStorages)
+{
+  Map<S> map;
+  for (std::uint64_t i = 0; i < 1000; ++i)
+    map[i] = std::to_string(i);
+
+  map.clear();
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK_EQUAL(map.getBucketCount(), 0);
+  BOOST_CHECK(map.begin() == map.end());
+  map[3] = "Three";
+  thenMapContainsItems(map, { { 3, "Three" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSparseMap_WhenRemovingFirstAndLastItems_ThenIterationStillVisitsTheRest,
+                              S,
+                              TestedStorages)
+{
+  Map<S> map;
+  map.reserve(10000);
+  for (std::uint64_t i = 0; i < 20; ++i)
+    map[i * 7919] = std::to_string(i);
+
+  while (map.getSize() > 2)
+  {
+    map.remove(map.begin());
+    map.remove(--map.end());
+  }
+
+  std::size_t forward = 0;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    ++forward;
+  std::size_t backward = 0;
+  for (auto it = map.end(); it != map.begin(); --it)
+    ++backward;
+  BOOST_CHECK_EQUAL(forward, 2);
+  BOOST_CHECK_EQUAL(backward, 2);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMaps_WhenCopyAssigning_ThenTargetIsALayoutCloneOfSource,
+                              S,
+                              TestedStorages)
+{
+  Map<S> source;
+  for (std::uint64_t i = 0; i < 500; ++i)
+    source[i * 3] = std::to_string(i);
+  for (std::uint64_t i = 0; i < 500; i += 5)
+    source.remove(i * 3);
+  Map<S> sameCapacity;
+  for (std::uint64_t i = 0; i < 500; ++i)
+    sameCapacity[i + 1000000] = "old";
+  Map<S> smaller = { { 1, "One" } };
+
+  sameCapacity = source;
+  smaller = source;
+  source = source;
+
+  for (const Map<S>* copy : { &sameCapacity, &smaller })
+  {
+    BOOST_CHECK(*copy == source);
+    BOOST_CHECK_EQUAL(copy->getBucketCount(), source.getBucketCount());
+    auto expected = source.begin();
+    for (auto it = copy->begin(); it != copy->end(); ++it, ++expected)
+      BOOST_CHECK_EQUAL(it->first, expected->first);
+  }
+  BOOST_CHECK_EQUAL(source.getSize(), 400);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenBatchOfPresentAndMissingKeys_WhenLookingThemUpInBatch_ThenResultsMatchFind,
+                              S,
+                              TestedStorages)
+{
+  Map<S> map;
+  std::vector<std::uint64_t> keys;
+  for (std::uint64_t i = 0; i < 1000; ++i)
+  {
+    if (i % 3)
+      map[i] = std::to_string(i);
+    keys.push_back((i * 7919) % 1100);
+  }
+  const Map<S>& constMap = map;
+
+  std::vector<typename Map<S>::iterator> found(keys.size(), map.end());
+  std::vector<typename Map<S>::const_iterator> constFound(keys.size(), constMap.end());
+  std::unique_ptr<bool[]> contained(new bool[keys.size()]);
+  map.find_batch(keys.data(), keys.size(), found.data());
+  constMap.find_batch(keys.data(), keys.size(), constFound.data());
+  constMap.contains_batch(keys.data(), keys.size(), contained.get());
+
+  for (std::size_t i = 0; i < keys.size(); ++i)
+  {
+    BOOST_CHECK(found[i] == map.find(keys[i]));
+    BOOST_CHECK(constFound[i] == constMap.find(keys[i]));
+    BOOST_CHECK_EQUAL(contained[i], keys[i] < 1000 && keys[i] % 3 != 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenBatchesOfEveryShortLength_WhenLookingThemUp_ThenEveryKeyIsResolved,
+                              S,
+                              TestedStorages)
+{
+  Map<S> map;
+  for (std::uint64_t i = 0; i < 100; i += 2)
+    map[i] = std::to_string(i);
+  std::vector<std::uint64_t> keys;
+  for (std::uint64_t i = 0; i < 64; ++i)
+    keys.push_back((i * 37) % 100);
+
+  // lengths below, at and past the distances between the prefetching and resolving stages
+  for (std::size_t n = 0; n <= keys.size(); ++n)
+  {
+    std::unique_ptr<bool[]> contained(new bool[n + 1]);
+    contained[n] = true;
+    map.contains_batch(keys.data(), n, contained.get());
+    for (std::size_t i = 0; i < n; ++i)
+      BOOST_CHECK_EQUAL(contained[i], keys[i] % 2 == 0);
+    BOOST_CHECK(contained[n]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenPlainIteratorArrays_WhenLookingUpBatch_ThenTheyPointAtFoundItems,
+                              S,
+                              TestedStorages)
+{
+  Map<S> map = { { 1, "One" }, { 2, "Two" }, { 40, "Forty" } };
+  const Map<S>& constMap = map;
+  const std::uint64_t keys[] = { 40, 3, 1 };
+
+  typename Map<S>::const_iterator constFound[3];
+  typename Map<S>::iterator found[3];
+  constMap.find_batch(keys, 3, constFound);
+  map.find_batch(keys, 3, found);
+
+  BOOST_REQUIRE(constFound[0] != constMap.end());
+  BOOST_CHECK_EQUAL(constFound[0]->second, "Forty");
+  BOOST_CHECK(constFound[1] == constMap.end());
+  BOOST_CHECK_EQUAL(constFound[2]->first, 1);
+  BOOST_REQUIRE(found[2] != map.end());
+  found[2]->second = "Uno";
+  BOOST_CHECK_EQUAL(map.valueOf(1), "Uno");
+  BOOST_CHECK(found[1] == map.end());
+  BOOST_CHECK(found[0] == map.find(40));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenLookingUpBatch_ThenNothingIsFound,
+                              S,
+                              TestedStorages)
+{
+  const Map<S> map;
+  const std::uint64_t keys[] = { 1, 2, 3 };
+  bool contained[] = { true, true, true };
+
+  map.contains_batch(keys, 3, contained);
+  map.contains_batch(keys, 0, nullptr);
+
+  BOOST_CHECK(!contained[0] && !contained[1] && !contained[2]);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenTakingStats_ThenEverythingIsZero,
+                              S,
+                              TestedStorages)
+{
+  const Map<S> map;
+
+  const auto stats = map.stats();
+
+  BOOST_CHECK_EQUAL(stats.size, 0);
+  BOOST_CHECK_EQUAL(stats.bucketCount, 0);
+  BOOST_CHECK_EQUAL(stats.occupiedBuckets, 0);
+  BOOST_CHECK_EQUAL(stats.maxChainLength, 0);
+  BOOST_CHECK_EQUAL(stats.loadFactor, 0.0f);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenTakingStats_ThenTheyDescribeTheTable,
+                              S,
+                              TestedStorages)
+{
+  Map<S> map;
+  for (std::uint64_t i = 0; i < 1000; ++i)
+    map[i] = std::to_string(i);
+
+  const auto stats = map.stats();
+
+  BOOST_CHECK_EQUAL(stats.size, 1000);
+  BOOST_CHECK_EQUAL(stats.bucketCount, map.getBucketCount());
+  BOOST_CHECK_CLOSE(stats.loadFactor, map.getLoadFactor(), 0.001);
+  BOOST_CHECK_GT(stats.occupiedBuckets, 0);
+  BOOST_CHECK_LE(stats.occupiedBuckets, stats.bucketCount);
+  BOOST_REQUIRE_EQUAL(stats.chainLengths.size(), stats.maxChainLength + 1);
+  BOOST_CHECK_GT(stats.chainLengths.back(), 0);
+  BOOST_CHECK_GE(stats.bytesUsed, 1000 * sizeof(typename Map<S>::value_type));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenHitsAndMisses_WhenTakingStats_ThenLookupsAreCountedWhenEnabled,
+                              S,
+                              TestedStorages)
+{
+  Map<S> map;
+  for (std::uint64_t i = 0; i < 100; ++i)
+    map[i] = std::to_string(i);
+
+  for (std::uint64_t i = 0; i < 15; ++i)
+    map.find(i * 10);
+  const auto stats = map.stats();
+  map.resetCounters();
+
+  if (aisdi::FindCounters::enabled)
+  {
+    BOOST_CHECK_EQUAL(stats.finds, 15);
+    BOOST_CHECK_EQUAL(stats.hits, 10);
+    BOOST_CHECK_EQUAL(stats.misses, 5);
+    BOOST_CHECK_GE(stats.getProbesPerFind(), 10.0 / 15);
+  }
+  else
+    BOOST_CHECK_EQUAL(stats.finds, 0);
+  BOOST_CHECK_EQUAL(map.stats().finds, 0);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenErasingWhileIterating_ThenEveryOtherItemIsVisitedOnceAndKept,
+                              S,
+                              TestedStorages)
+{
+  Map<S> map;
+  std::map<std::uint64_t, std::string> expected;
+  for (std::uint64_t i = 0; i < 1000; ++i)
+  {
+    map[i * 7919] = std::to_string(i);
+    if (i % 3)
+      expected[i * 7919] = std::to_string(i);
+  }
+  const std::size_t bucketCount = map.getBucketCount();
+
+  std::map<std::uint64_t, int> visits;
+  for (auto it = map.begin(); it != map.end();)
+  {
+    if ((it->first / 7919) % 3 == 0)
+      it = map.erase(it);
+    else
+      ++visits[(it++)->first];
+  }
+
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK_EQUAL(visits.size(), expected.size());
+  for (const auto& visit : visits)
+    BOOST_CHECK_EQUAL(visit.second, 1);
+  BOOST_CHECK_EQUAL(map.getBucketCount(), bucketCount);
+  BOOST_CHECK_THROW(map.erase(map.end()), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenErasingRanges_ThenOnlyTheirItemsAreRemoved,
+                              S,
+                              TestedStorages)
+{
+  Map<S> map;
+  for (std::uint64_t i = 0; i < 100; ++i)
+    map[i] = std::to_string(i);
+  auto first = map.begin();
+  for (int i = 0; i < 10; ++i)
+    ++first;
+  auto last = first;
+  for (int i = 0; i < 30; ++i)
+    ++last;
+  const std::uint64_t lastKey = last->first;
+  std::map<std::uint64_t, std::string> expected;
+  for (auto it = map.begin(); it != first; ++it)
+    expected.insert(*it);
+  for (auto it = last; it != map.end(); ++it)
+    expected.insert(*it);
+
+  const auto following = map.erase(first, last);
+
+  BOOST_CHECK_EQUAL(following->first, lastKey);
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK(map.erase(following, following) == following);
+  const auto afterAll = map.erase(map.begin(), map.end());
+  BOOST_CHECK(afterAll == map.end());
+  BOOST_CHECK(map.isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenCollidingKeys_WhenErasingRanges_ThenLastItemIsKept,
+                              S,
+                              TestedStorages)
+{
+  CollidingMap<S> map;
+  std::map<std::uint64_t, std::string> expected;
+  for (std::uint64_t i = 0; i < 100; ++i)
+    expected[i] = map[i] = std::to_string(i);
+
+  // last shares its run or its tree bin with the erased items, the bin turns back into a chain
+  while (map.getSize() > 4)
+  {
+    auto first = map.begin();
+    ++first;
+    auto last = first;
+    for (int i = 0; i < 3; ++i)
+      expected.erase((last++)->first);
+    const std::uint64_t lastKey = last->first;
+
+    const auto following = map.erase(first, last);
+
+    BOOST_REQUIRE(following != map.end());
+    BOOST_CHECK_EQUAL(following->first, lastKey);
+    BOOST_REQUIRE_EQUAL(map.getSize(), expected.size());
+  }
+  for (const auto& item : expected)
+  {
+    const auto it = map.find(item.first);
+    BOOST_REQUIRE_MESSAGE(it != map.end(), "Missing required item with key: " << item.first);
+    BOOST_CHECK_EQUAL(it->second, item.second);
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenCollidingKeys_WhenErasingIf_ThenMatchingItemsAreRemovedInOneSweep,
+                              S,
+                              TestedStorages)
+{
+  CollidingMap<S> map;
+  for (std::uint64_t i = 0; i < 100; ++i)
+    map[i] = std::to_string(i);
+
+  const auto removed = erase_if(map, [](const typename CollidingMap<S>::value_type& item) {
+    return item.first < 95;
+  });
+
+  BOOST_CHECK_EQUAL(removed, 95);
+  BOOST_CHECK_EQUAL(map.getSize(), 5);
+  for (std::uint64_t i = 0; i < 100; ++i)
+    BOOST_CHECK_EQUAL(map.find(i) != map.end(), i >= 95);
+  BOOST_CHECK_EQUAL(erase_if(map, [](const typename CollidingMap<S>::value_type&) { return false; }), 0);
+}
+
+BOOST_AUTO_TEST_CASE(GivenFewItems_WhenUsingSmallStorage_ThenTheyStayInlineWithoutBuckets)
+{
+  Map<aisdi::SmallStorage<8>> map;
+  for (std::uint64_t i = 0; i < 8; ++i)
+    map[i * 7919] = std::to_string(i);
+  map.remove(7919);
+  map[1] = "One";
+
+  BOOST_CHECK_EQUAL(map.getBucketCount(), 0);
+  BOOST_CHECK_EQUAL(map.getSize(), 8);
+  BOOST_CHECK_EQUAL(map.stats().bytesUsed, sizeof(map));
+  BOOST_CHECK_EQUAL(map.valueOf(1), "One");
+  BOOST_CHECK(map.find(7919) == map.end());
+  std::size_t backward = 0;
+  for (auto it = map.end(); it != map.begin(); --it)
+    ++backward;
+  BOOST_CHECK_EQUAL(backward, 8);
+}
+
+BOOST_AUTO_TEST_CASE(GivenFullInlineSlots_WhenAddingOneMore_ThenSmallStorageMovesToBucketsAndBackWhenEmptied)
+{
+  Map<aisdi::SmallStorage<8>> map;
+  for (std::uint64_t i = 0; i < 9; ++i)
+    map[i] = std::to_string(i);
+
+  BOOST_CHECK_GT(map.getBucketCount(), 0);
+  thenMapContainsItems(map, { { 0, "0" }, { 1, "1" }, { 2, "2" }, { 3, "3" }, { 4, "4" },
+                              { 5, "5" }, { 6, "6" }, { 7, "7" }, { 8, "8" } });
+
+  for (std::uint64_t i = 0; i < 9; ++i)
+    map.remove(i);
+  map[3] = "Three";
+  BOOST_CHECK_EQUAL(map.getBucketCount(), 0);
+  thenMapContainsItems(map, { { 3, "Three" } });
+}
+
+BOOST_AUTO_TEST_CASE(GivenThrowingHash_WhenSmallStorageSpillFails_ThenInlineItemsKeepTheirValues)
+{
+  aisdi::HashMap<std::uint64_t, std::string, ThrowingHash, std::equal_to<std::uint64_t>, aisdi::SmallStorage<4>> map;
+  aisdi::HashMap<std::uint64_t, std::unique_ptr<std::uint64_t>,
+                 ThrowingHash, std::equal_to<std::uint64_t>, aisdi::SmallStorage<4>> moveOnly;
+  for (std::uint64_t i = 10; i < 14; ++i)
+  {
+    map.emplace(i, std::string(64, 'a' + i));
+    moveOnly.emplace(i, new std::uint64_t(i));
+  }
+
+  BOOST_CHECK_THROW(map.emplace(20, "twenty"), std::invalid_argument);
+  BOOST_CHECK_THROW(moveOnly.emplace(20, new std::uint64_t(20)), std::invalid_argument);
+
+  BOOST_CHECK_EQUAL(map.getBucketCount(), 0);
+  BOOST_CHECK_EQUAL(map.getSize(), 4);
+  BOOST_CHECK_EQUAL(moveOnly.getSize(), 4);
+  for (std::uint64_t i = 10; i < 14; ++i)
+  {
+    BOOST_CHECK_EQUAL(map.valueOf(i), std::string(64, 'a' + i));
+    BOOST_REQUIRE(moveOnly.valueOf(i) != nullptr);
+    BOOST_CHECK_EQUAL(*moveOnly.valueOf(i), i);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenStringKeys_WhenSwappingAndMovingSmallStorageMaps_ThenItemsStayInline)
+{
+  using SmallMap = aisdi::HashMap<std::string, int, std::hash<std::string>,
+                                  std::equal_to<std::string>, aisdi::SmallStorage<8>>;
+  static_assert(std::is_nothrow_move_constructible<SmallMap>::value, "moving a small map must not throw");
+  static_assert(std::is_nothrow_move_assignable<SmallMap>::value, "moving a small map must not throw");
+
+  SmallMap map;
+  SmallMap other;
+  map[std::string(64, 'a')] = 1;
+  other[std::string(64, 'b')] = 2;
+  other[std::string(64, 'c')] = 3;
+
+  map.swap(other);
+  SmallMap moved(std::move(other));
+
+  BOOST_CHECK_EQUAL(map.getBucketCount(), 0);
+  BOOST_CHECK_EQUAL(moved.getBucketCount(), 0);
+  BOOST_CHECK_EQUAL(other.getSize(), 0);
+  BOOST_CHECK_EQUAL(map.getSize(), 2);
+  BOOST_CHECK_EQUAL(map.valueOf(std::string(64, 'b')), 2);
+  BOOST_CHECK_EQUAL(map.valueOf(std::string(64, 'c')), 3);
+  BOOST_CHECK_EQUAL(moved.getSize(), 1);
+  BOOST_CHECK_EQUAL(moved.valueOf(std::string(64, 'a')), 1);
+}
+
+BOOST_AUTO_TEST_CASE(GivenThrowingMoves_WhenSmallStorageSwapFails_ThenSizesMatchItemsLeft)
+{
+  using SmallMap = aisdi::HashMap<std::uint64_t, ThrowingMove, std::hash<std::uint64_t>,
+                                  std::equal_to<std::uint64_t>, aisdi::SmallStorage<4>>;
+  SmallMap map;
+  SmallMap other;
+  SmallMap spilled;
+  for (std::uint64_t i = 0; i < 3; ++i)
+  {
+    map[i] = ThrowingMove(static_cast<int>(i));
+    other[i + 10] = ThrowingMove(static_cast<int>(i + 10));
+  }
+  for (std::uint64_t i = 0; i < 10; ++i)
+    spilled[i + 20] = ThrowingMove(static_cast<int>(i + 20));
+
+  ThrowingMove::movesLeft = 4;
+  BOOST_CHECK_THROW(map.swap(other), std::runtime_error);
+  ThrowingMove::movesLeft = 0;
+  BOOST_CHECK_THROW(spilled.swap(map), std::runtime_error);
+  ThrowingMove::movesLeft = -1;
+
+  for (const SmallMap* m : { &map, &other, &spilled })
+  {
+    std::size_t visited = 0;
+    for (const auto& item : *m)
+    {
+      BOOST_CHECK_EQUAL(item.second.value, static_cast<int>(item.first));
+      ++visited;
+    }
+    BOOST_CHECK_EQUAL(visited, m->getSize());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenOpenAddressingStorage_WhenSettingMaxLoadFactorAboveItsCeiling_ThenItThrows)
+{
+  Map<aisdi::ChainedStorage> chained;
+  Map<aisdi::RobinHoodStorage> robinHood;
+  Map<aisdi::SwissStorage> swiss;
+  for (std::uint64_t i = 0; i < 100; ++i)
+    chained[i] = robinHood[i] = swiss[i] = std::to_string(i);
+
+  chained.setMaxLoadFactor(2.0f);
+  robinHood.setMaxLoadFactor(1.0f);
+  swiss.setMaxLoadFactor(0.9375f);
+  BOOST_CHECK_THROW(robinHood.setMaxLoadFactor(1.5f), std::invalid_argument);
+  BOOST_CHECK_THROW(swiss.setMaxLoadFactor(0.95f), std::invalid_argument);
+
+  BOOST_CHECK_EQUAL(chained.getMaxLoadFactor(), 2.0f);
+  BOOST_CHECK_EQUAL(robinHood.getMaxLoadFactor(), 1.0f);
+  BOOST_CHECK_EQUAL(swiss.getMaxLoadFactor(), 0.9375f);
+  BOOST_CHECK_EQUAL(robinHood.getSize(), 100);
+  BOOST_CHECK_EQUAL(swiss.getSize(), 100);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMoveOnlyValues_WhenEmplacingAndRemovingManyItems_ThenNothingIsCopied,
+                              S,
+                              TestedStorages)
+{
+  aisdi::HashMap<std::uint64_t, std::unique_ptr<std::uint64_t>,
+                 std::hash<std::uint64_t>, std::equal_to<std::uint64_t>, S> map;
+
+  for (std::uint64_t i = 0; i < 1000; ++i)
+    BOOST_CHECK(map.try_emplace(i, new std::uint64_t(i)).second);
+  for (std::uint64_t i = 0; i < 1000; i += 2)
+    map.remove(i);
+  for (std::uint64_t i = 0; i < 1000; ++i)
+    BOOST_CHECK_EQUAL(map.insert_or_assign(i, std::unique_ptr<std::uint64_t>(new std::uint64_t(i + 1))).second,
+                      i % 2 == 0);
+  BOOST_CHECK(!map.emplace(7, nullptr).second);
+
+  BOOST_CHECK_EQUAL(map.getSize(), 1000);
+  for (std::uint64_t i = 0; i < 1000; ++i)
+    BOOST_CHECK_EQUAL(*map.valueOf(i), i + 1);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenThrowingMove_WhenRehashingFails_ThenSizeMatchesEntriesLeft,
+                              S,
+                              ThrowingMoveStorages)
+{
+  aisdi::HashMap<std::uint64_t, ThrowingMove, std::hash<std::uint64_t>, std::equal_to<std::uint64_t>, S> map;
+  for (std::uint64_t i = 0; i < 100; ++i)
+    map[i] = ThrowingMove(static_cast<int>(i));
+
+  ThrowingMove::movesLeft = 10;
+  try
+  {
+    map.rehash(4096);
+  }
+  catch (const std::runtime_error&)
+  {
+  }
+  ThrowingMove::movesLeft = -1;
+
+  std::size_t visited = 0;
+  for (const auto& item : map)
+  {
+    BOOST_CHECK_EQUAL(item.second.value, static_cast<int>(item.first));
+    ++visited;
+  }
+  BOOST_CHECK_EQUAL(visited, map.getSize());
+  map.clear();
+  map[1] = ThrowingMove(1);
+  BOOST_CHECK_EQUAL(map.getSize(), 1);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenThrowingCopiesAndMoves_WhenRehashingCollidingKeysFails_ThenEveryItemIsFound,
+                              S,
+                              ThrowingMoveStorages)
+{
+  aisdi::HashMap<std::uint64_t, ThrowingMove, ConstantHash, std::equal_to<std::uint64_t>, S> map;
+  for (std::uint64_t i = 0; i < 40; ++i)
+    map[i] = ThrowingMove(static_cast<int>(i));
+
+  ThrowingMove::movesLeft = 3;
+  ThrowingMove::copiesLeft = 3;
+  try
+  {
+    map.rehash(4096);
+  }
+  catch (const std::runtime_error&)
+  {
+  }
+  ThrowingMove::movesLeft = -1;
+  ThrowingMove::copiesLeft = -1;
+
+  BOOST_CHECK_EQUAL(map.getSize(), 40);
+  for (std::uint64_t i = 0; i < 40; ++i)
+  {
+    const auto it = map.find(i);
+    BOOST_REQUIRE_MESSAGE(it != map.end(), "Missing required item with key: " << i);
+    BOOST_CHECK_EQUAL(it->second.value, static_cast<int>(i));
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenThrowingHash_WhenRehashingMoveOnlyItemsFails_ThenEveryItemIsFound,
+                              S,
+                              TestedStorages)
+{
+  for (bool collide : { false, true })
+  {
+    CountdownHash::collide = collide;
+    aisdi::HashMap<std::uint64_t, std::unique_ptr<std::uint64_t>,
+                   CountdownHash, std::equal_to<std::uint64_t>, S> map;
+    for (std::uint64_t i = 0; i < 40; ++i)
+      map.emplace(i, new std::uint64_t(i));
+
+    CountdownHash::callsLeft = 20;
+    try
+    {
+      map.rehash(4096);
+    }
+    catch (const std::runtime_error&)
+    {
+    }
+    CountdownHash::callsLeft = -1;
+
+    BOOST_CHECK_EQUAL(map.getSize(), 40);
+    for (std::uint64_t i = 0; i < 40; ++i)
+    {
+      const auto it = map.find(i);
+      BOOST_REQUIRE_MESSAGE(it != map.end(), "Missing required item with key: " << i);
+      BOOST_REQUIRE(it->second != nullptr);
+      BOOST_CHECK_EQUAL(*it->second, i);
+    }
+  }
+  CountdownHash::collide = false;
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenHashThrowingWhileShrinking_WhenRemovingItems_ThenEveryRemoveSucceeds,
+                              S,
+                              TestedStorages)
+{
+  aisdi::HashMap<std::uint64_t, std::string, CountdownHash, std::equal_to<std::uint64_t>, S> map;
+  for (std::uint64_t i = 0; i < 1000; ++i)
+    map.emplace(i, std::to_string(i));
+
+  // the lookup of each remove gets its hash, anything after it fails
+  for (std::uint64_t i = 0; i < 1000; ++i)
+  {
+    if (i % 10 == 9)
+      continue;
+    CountdownHash::callsLeft = 1;
+    BOOST_CHECK_NO_THROW(map.remove(i));
+  }
+  CountdownHash::callsLeft = -1;
+
+  BOOST_CHECK_EQUAL(map.getSize(), 100);
+  for (std::uint64_t i = 0; i < 1000; ++i)
+    BOOST_CHECK_EQUAL(map.find(i) != map.end(), i % 10 == 9);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenThrowingMoves_WhenRemovingFromCollidingKeys_ThenEveryItemLeftIsFound,
+                              S,
+                              ThrowingMoveStorages)
+{
+  aisdi::HashMap<std::uint64_t, ThrowingMove, ConstantHash, std::equal_to<std::uint64_t>, S> map;
+  for (std::uint64_t i = 0; i < 40; ++i)
+    map[i] = ThrowingMove(static_cast<int>(i));
+
+  ThrowingMove::movesLeft = 3;
+  try
+  {
+    map.remove(0);
+  }
+  catch (const std::runtime_error&)
+  {
+  }
+  ThrowingMove::movesLeft = -1;
+
+  std::size_t found = 0;
+  for (std::uint64_t i = 1; i < 40; ++i)
+  {
+    const auto it = map.find(i);
+    if (it == map.end())
+      continue;
+    BOOST_CHECK_EQUAL(it->second.value, static_cast<int>(i));
+    ++found;
+  }
+  std::size_t visited = 0;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    ++visited;
+  BOOST_CHECK(map.find(0) == map.end());
+  BOOST_CHECK_EQUAL(map.getSize(), found);
+  BOOST_CHECK_EQUAL(visited, found);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenThrowingHash_WhenEmplacing_ThenMapIsUnchanged,
+                              S,
+                              TestedStorages)
+{
+  aisdi::HashMap<std::uint64_t, std::string, ThrowingHash, std::equal_to<std::uint64_t>, S> map;
+  // more items than any inline storage holds, so every storage hashes
+  for (std::uint64_t i = 0; i < 40; ++i)
+    map.emplace(i + 20, std::string(64, 'x'));
+
+  BOOST_CHECK_THROW(map.emplace(13, std::string(64, 'y')), std::invalid_argument);
+
+  BOOST_CHECK_EQUAL(map.getSize(), 40);
+  BOOST_CHECK(map.emplace(12, "twelve").second);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
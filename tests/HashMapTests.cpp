@@ -1,8 +1,12 @@
 #include <HashMap.h>
 
+#include <algorithm>
+#include <cctype>
 #include <cstdint>
 #include <string>
 #include <map>
+#include <tuple>
+#include <utility>
 
 #include <boost/test/unit_test.hpp>
 
@@ -591,6 +595,359 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMapsWithDifferentKeys_WhenComparingThem_Th
   BOOST_CHECK(map != other);
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenAddingManyItems_ThenLoadFactorStaysBelowMaximum,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+
+  for (int i = 0; i < 10000; ++i)
+  {
+    map[i] = std::to_string(i);
+    expected[i] = std::to_string(i);
+  }
+
+  BOOST_CHECK_LE(map.getLoadFactor(), map.getMaxLoadFactor());
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenLargeMap_WhenRemovingMostItems_ThenBucketArrayShrinks,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 10000; ++i)
+    map[i] = std::to_string(i);
+  const auto grownBucketCount = map.getBucketCount();
+
+  for (int i = 10; i < 10000; ++i)
+    map.remove(i);
+
+  BOOST_CHECK_LT(map.getBucketCount(), grownBucketCount);
+  thenMapContainsItems(map, { { 0, "0" }, { 1, "1" }, { 2, "2" }, { 3, "3" }, { 4, "4" },
+                              { 5, "5" }, { 6, "6" }, { 7, "7" }, { 8, "8" }, { 9, "9" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenReserving_ThenInsertingUpToReservedSizeDoesNotRehash,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+
+  map.reserve(5000);
+  const auto reservedBucketCount = map.getBucketCount();
+  for (int i = 0; i < 5000; ++i)
+    map[i] = std::string{};
+
+  BOOST_CHECK_GE(reservedBucketCount * map.getMaxLoadFactor(), 5000);
+  BOOST_CHECK_EQUAL(map.getBucketCount(), reservedBucketCount);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenRehashing_ThenAllItemsAreStillInMap,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" }, { 1410, "Grunwald" } };
+
+  map.rehash(1000);
+  BOOST_CHECK_GE(map.getBucketCount(), 1000);
+  thenMapContainsItems(map, { { 753, "Rome" }, { 1789, "Paris" }, { 1410, "Grunwald" } });
+
+  map.rehash(0);
+  thenMapContainsItems(map, { { 753, "Rome" }, { 1789, "Paris" }, { 1410, "Grunwald" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenLoweringMaxLoadFactor_ThenBucketArrayGrows,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 1000; ++i)
+    map[i] = std::string{};
+
+  map.setMaxLoadFactor(0.25f);
+
+  BOOST_CHECK_LE(map.getLoadFactor(), 0.25f);
+  BOOST_CHECK_EQUAL(map.getSize(), 1000);
+  BOOST_CHECK_THROW(map.setMaxLoadFactor(0.0f), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenCreatedWithDefaultConstructor_ThenNoBucketsAreAllocated,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map;
+
+  BOOST_CHECK_EQUAL(map.getBucketCount(), 0);
+  BOOST_CHECK(map.find(42) == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenMoving_ThenSourceHasNoBuckets,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" } };
+  const auto bucketCount = map.getBucketCount();
+
+  Map<K> other{std::move(map)};
+  BOOST_CHECK_EQUAL(map.getBucketCount(), 0);
+  BOOST_CHECK_EQUAL(other.getBucketCount(), bucketCount);
+
+  Map<K> assigned = { { 42, "Alice" } };
+  assigned = std::move(other);
+  BOOST_CHECK_EQUAL(other.getBucketCount(), 0);
+  thenMapContainsItems(assigned, { { 753, "Rome" }, { 1789, "Paris" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMovedFromMap_WhenAddingItem_ThenItIsInMap,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 753, "Rome" } };
+  Map<K> other{std::move(map)};
+
+  map[1410] = "Grunwald";
+
+  thenMapContainsItems(map, { { 1410, "Grunwald" } });
+  thenMapContainsItems(other, { { 753, "Rome" } });
+}
+
+struct CaseInsensitiveHash
+{
+  std::size_t operator()(const std::string& key) const
+  {
+    std::string lowered;
+    for (char c : key)
+      lowered += static_cast<char>(std::tolower(c));
+    return std::hash<std::string>{}(lowered);
+  }
+};
+
+struct CaseInsensitiveEqual
+{
+  bool operator()(const std::string& lhs, const std::string& rhs) const
+  {
+    return lhs.size() == rhs.size()
+      && std::equal(lhs.begin(), lhs.end(), rhs.begin(),
+                    [](char a, char b) { return std::tolower(a) == std::tolower(b); });
+  }
+};
+
+BOOST_AUTO_TEST_CASE(GivenMapWithCustomHashAndEquality_WhenSearchingForEquivalentKey_ThenItemIsReturned)
+{
+  aisdi::HashMap<std::string, int, CaseInsensitiveHash, CaseInsensitiveEqual> map;
+  map["Alice"] = 1;
+  map["BOB"] = 2;
+
+  map["alice"] = 3;
+
+  BOOST_CHECK_EQUAL(map.getSize(), 2);
+  BOOST_CHECK_EQUAL(map.valueOf("ALICE"), 3);
+  BOOST_CHECK_EQUAL(map.valueOf("bob"), 2);
+}
+
+struct IdentityAvalanchingHash
+{
+  using is_avalanching = void;
+
+  std::size_t operator()(std::uint64_t key) const
+  {
+    return key;
+  }
+};
+
+BOOST_AUTO_TEST_CASE(GivenAvalanchingHash_WhenHashing_ThenNoExtraMixingIsApplied)
+{
+  const aisdi::MixedHash<std::uint64_t, IdentityAvalanchingHash> avalanching;
+  const aisdi::MixedHash<std::uint64_t, std::hash<std::uint64_t>> mixed;
+
+  BOOST_CHECK_EQUAL(avalanching(12345), 12345);
+  BOOST_CHECK_NE(mixed(12345), std::hash<std::uint64_t>{}(12345));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapWithKey_WhenTryEmplacing_ThenArgumentsAreNotConsumed, K, TestedKeyTypes)
+{
+  Map<K> map = {{753, "Alice"}};
+  std::string value = "Bob";
+
+  const auto result = map.try_emplace(753, std::move(value));
+
+  BOOST_CHECK(!result.second);
+  BOOST_CHECK(result.first == map.find(753));
+  BOOST_CHECK_EQUAL(value, "Bob");
+  thenMapContainsItems(map, {{753, "Alice"}});
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenTryEmplacing_ThenValueIsBuiltFromArguments, K, TestedKeyTypes)
+{
+  Map<K> map;
+
+  const auto result = map.try_emplace(753, 3, 'a');
+
+  BOOST_CHECK(result.second);
+  BOOST_CHECK_EQUAL(result.first->second, "aaa");
+  thenMapContainsItems(map, {{753, "aaa"}});
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenInsertingOrAssigning_ThenValueIsOverwritten, K, TestedKeyTypes)
+{
+  Map<K> map = {{753, "Alice"}};
+
+  const auto assigned = map.insert_or_assign(753, "Bob");
+  const auto inserted = map.insert_or_assign(42, "Chuck");
+
+  BOOST_CHECK(!assigned.second);
+  BOOST_CHECK_EQUAL(assigned.first->second, "Bob");
+  BOOST_CHECK(inserted.second);
+  thenMapContainsItems(map, {{753, "Bob"}, {42, "Chuck"}});
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapWithKey_WhenEmplacingOrInserting_ThenOldValueStays, K, TestedKeyTypes)
+{
+  Map<K> map = {{753, "Alice"}};
+
+  const auto emplaced = map.emplace(753, "Bob");
+  const auto inserted = map.insert(typename Map<K>::value_type(753, "Chuck"));
+  const auto added = map.emplace(std::piecewise_construct, std::forward_as_tuple(42), std::forward_as_tuple(2, 'x'));
+
+  BOOST_CHECK(!emplaced.second);
+  BOOST_CHECK(emplaced.first == map.find(753));
+  BOOST_CHECK(!inserted.second);
+  BOOST_CHECK(added.second);
+  thenMapContainsItems(map, {{753, "Alice"}, {42, "xx"}});
+}
+
+BOOST_AUTO_TEST_CASE(GivenMap_WhenIndexingWithTemporaryKey_ThenKeyIsMovedIn)
+{
+  aisdi::HashMap<std::string, int> map;
+  std::string key(100, 'k');
+
+  map[std::move(key)] = 1;
+
+  BOOST_CHECK(key.empty());
+  BOOST_CHECK_EQUAL(map.valueOf(std::string(100, 'k')), 1);
+}
+
+struct CountingHash
+{
+  static std::size_t calls;
+
+  std::size_t operator()(std::uint64_t key) const
+  {
+    ++calls;
+    return std::hash<std::uint64_t>{}(key);
+  }
+};
+
+std::size_t CountingHash::calls = 0;
+
+BOOST_AUTO_TEST_CASE(GivenNonEmptyMap_WhenRehashingAndCopying_ThenKeysAreNotHashedAgain)
+{
+  aisdi::HashMap<std::uint64_t, std::string, CountingHash> map;
+  for (std::uint64_t i = 0; i < 1000; ++i)
+    map[i] = std::to_string(i);
+  const std::size_t callsAfterInsert = CountingHash::calls;
+
+  map.rehash(map.getBucketCount() * 4);
+  const auto copy = map;
+  map.reserve(100000);
+
+  BOOST_CHECK_EQUAL(CountingHash::calls, callsAfterInsert);
+  BOOST_CHECK(copy == map);
+}
+
+struct ConstantHash
+{
+  template <typename T>
+  std::size_t operator()(const T&) const
+  {
+    return 42;
+  }
+};
+
+BOOST_AUTO_TEST_CASE(GivenThousandsOfCollidingKeys_WhenAddingRemovingAndCopying_ThenMapMatchesStdMap)
+{
+  aisdi::HashMap<std::uint64_t, std::string, ConstantHash> map;
+  std::map<std::uint64_t, std::string> expected;
+  for (std::uint64_t i = 0; i < 3000; ++i)
+  {
+    const std::uint64_t key = (i * 7919) % 3000;
+    map[key] = std::to_string(key);
+    expected[key] = std::to_string(key);
+  }
+  for (std::uint64_t i = 0; i < 3000; i += 3)
+  {
+    map.remove(i);
+    expected.erase(i);
+  }
+  const auto copy = map;
+
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+  for (std::uint64_t i = 0; i < 3000; ++i)
+    BOOST_CHECK_EQUAL(map.find(i) != map.end(), expected.count(i) == 1);
+  std::size_t visited = 0;
+  for (auto it = map.end(); it != map.begin(); ++visited)
+    --it;
+  BOOST_CHECK_EQUAL(visited, expected.size());
+  BOOST_CHECK(copy == map);
+}
+
+BOOST_AUTO_TEST_CASE(GivenCollidingKeysWithoutOrder_WhenShrinkingBackToFewItems_ThenEveryKeyIsFound)
+{
+  aisdi::HashMap<std::string, int, ConstantHash, CaseInsensitiveEqual> map;
+  map.reserve(100);
+  for (int i = 0; i < 100; ++i)
+    map["Key" + std::to_string(i)] = i;
+
+  for (int i = 0; i < 100; ++i)
+    BOOST_CHECK_EQUAL(map.valueOf("KEY" + std::to_string(i)), i);
+  for (int i = 5; i < 100; ++i)
+    map.remove("key" + std::to_string(i));
+
+  BOOST_CHECK_EQUAL(map.getSize(), 5);
+  for (int i = 0; i < 5; ++i)
+    BOOST_CHECK_EQUAL(map.valueOf("key" + std::to_string(i)), i);
+}
+
+BOOST_AUTO_TEST_CASE(GivenCollidingKeys_WhenTakingStats_ThenOneLongChainIsReported)
+{
+  aisdi::HashMap<std::uint64_t, std::string, ConstantHash> map;
+  for (std::uint64_t i = 0; i < 100; ++i)
+    map[i] = std::to_string(i);
+
+  const auto stats = map.stats();
+
+  BOOST_CHECK_EQUAL(stats.occupiedBuckets, 1);
+  BOOST_CHECK_EQUAL(stats.maxChainLength, 100);
+  BOOST_CHECK_EQUAL(stats.chainLengths[100], 1);
+  BOOST_CHECK_EQUAL(stats.chainLengths[0], stats.bucketCount - 1);
+}
+
+BOOST_AUTO_TEST_CASE(GivenTwoSeeds_WhenHashing_ThenSameKeyGetsDifferentHashes)
+{
+  const aisdi::MixedHash<std::uint64_t, IdentityAvalanchingHash> first(IdentityAvalanchingHash(), 1);
+  const aisdi::MixedHash<std::uint64_t, IdentityAvalanchingHash> second(IdentityAvalanchingHash(), 2);
+
+  BOOST_CHECK_NE(first(12345), second(12345));
+  BOOST_CHECK_NE(first(12345), 12345);
+  BOOST_CHECK_NE(aisdi::randomHashSeed(), 0);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenSettingHashSeed_ThenItemsStayAndCopiesKeepSeed, K, TestedKeyTypes)
+{
+  Map<K> map = {{753, "Rome"}, {1410, "Grunwald"}, {1789, "Paris"}};
+  BOOST_CHECK_EQUAL(map.getHashSeed(), 0);
+
+  map.setHashSeed(0x5eed);
+  const auto copy = map;
+
+  BOOST_CHECK_EQUAL(map.getHashSeed(), 0x5eed);
+  BOOST_CHECK_EQUAL(copy.getHashSeed(), 0x5eed);
+  thenMapContainsItems(map, {{753, "Rome"}, {1410, "Grunwald"}, {1789, "Paris"}});
+  thenMapContainsItems(copy, {{753, "Rome"}, {1410, "Grunwald"}, {1789, "Paris"}});
+}
+
 // ConstIterator is tested via Iterator methods.
 // If Iterator methods are to be changed, then new ConstIterator tests are required.
 
@@ -0,0 +1,251 @@
+#include <MappedHashMap.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <sys/stat.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+
+struct Point
+{
+  std::int32_t x;
+  double y;
+};
+
+using Map = aisdi::HashMap<std::uint64_t, Point>;
+using Mapped = aisdi::MappedHashMap<std::uint64_t, Point>;
+
+// removes the image file when the test is done with it
+struct ImageFile
+{
+  const std::string path;
+
+  explicit ImageFile(const std::string& name) : path(name)
+  {
+    std::remove(path.c_str());
+  }
+
+  ~ImageFile()
+  {
+    std::remove(path.c_str());
+  }
+};
+
+void flipByte(const std::string& path, long offset, std::ios::seekdir from = std::ios::end)
+{
+  std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+  file.seekg(offset, from);
+  char byte;
+  file.get(byte);
+  file.seekp(offset, from);
+  file.put(static_cast<char>(byte ^ 0x55));
+}
+
+void overwriteWord(const std::string& path, std::size_t offset, std::uint64_t value)
+{
+  std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+  file.seekp(static_cast<long>(offset), std::ios::beg);
+  file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(MappedHashMapTests)
+
+BOOST_AUTO_TEST_CASE(GivenSavedMap_WhenOpeningMapped_ThenAllItemsCanBeFound)
+{
+  ImageFile image("MappedHashMapTests.items.img");
+  Map map;
+  for (std::uint64_t i = 0; i < 10000; ++i)
+    map[i * 3] = Point{static_cast<std::int32_t>(i), i / 2.0};
+
+  aisdi::save(map, image.path);
+  const auto mapped = Mapped::open(image.path);
+
+  BOOST_CHECK_EQUAL(mapped.getSize(), 10000);
+  for (std::uint64_t i = 0; i < 10000; ++i)
+  {
+    const auto it = mapped.find(i * 3);
+    BOOST_REQUIRE(it != mapped.end());
+    BOOST_CHECK_EQUAL(it->second.x, static_cast<std::int32_t>(i));
+    BOOST_CHECK_EQUAL(it->second.y, i / 2.0);
+    BOOST_CHECK(!mapped.contains(i * 3 + 1));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenMappedMap_WhenIterating_ThenEveryItemIsVisitedOnce)
+{
+  ImageFile image("MappedHashMapTests.iteration.img");
+  Map map;
+  for (std::uint64_t i = 0; i < 500; ++i)
+    map[i] = Point{static_cast<std::int32_t>(i), 0.0};
+  aisdi::save(map, image.path);
+
+  const auto mapped = Mapped::open(image.path);
+  std::uint64_t count = 0;
+  std::uint64_t keySum = 0;
+  for (const auto& item : mapped)
+  {
+    ++count;
+    keySum += item.first;
+    BOOST_CHECK_EQUAL(item.second.x, static_cast<std::int32_t>(item.first));
+  }
+
+  BOOST_CHECK_EQUAL(count, 500);
+  BOOST_CHECK_EQUAL(keySum, 499 * 500 / 2);
+}
+
+BOOST_AUTO_TEST_CASE(GivenEmptyMap_WhenSavedAndMapped_ThenMappedMapIsEmpty)
+{
+  ImageFile image("MappedHashMapTests.empty.img");
+  const Map map;
+
+  aisdi::save(map, image.path);
+  const auto mapped = Mapped::open(image.path);
+
+  BOOST_CHECK(mapped.isEmpty());
+  BOOST_CHECK(mapped.begin() == mapped.end());
+  BOOST_CHECK(mapped.find(42) == mapped.end());
+  BOOST_CHECK_THROW(mapped.valueOf(42), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(GivenSavedMap_WhenCheckingImageMode_ThenOnlyOwnerCanAccessIt)
+{
+  ImageFile image("MappedHashMapTests.mode.img");
+  Map map;
+  map[1] = Point{ 1, 1.5 };
+
+  aisdi::save(map, image.path);
+
+  struct stat status;
+  BOOST_REQUIRE_EQUAL(::stat(image.path.c_str(), &status), 0);
+  BOOST_CHECK_EQUAL(status.st_mode & 0777, 0600);
+}
+
+BOOST_AUTO_TEST_CASE(GivenSeededMap_WhenSavedAndMapped_ThenSeedIsKept)
+{
+  ImageFile image("MappedHashMapTests.seeded.img");
+  Map map;
+  map[753] = Point{1, 2.0};
+  map.setHashSeed(0x5eed);
+
+  aisdi::save(map, image.path);
+  const auto mapped = Mapped::open(image.path);
+
+  BOOST_CHECK_EQUAL(mapped.getHashSeed(), 0x5eed);
+  BOOST_CHECK_EQUAL(mapped.valueOf(753).x, 1);
+}
+
+BOOST_AUTO_TEST_CASE(GivenCorruptedImage_WhenOpeningMapped_ThenChecksumCatchesIt)
+{
+  ImageFile image("MappedHashMapTests.corrupted.img");
+  Map map;
+  for (std::uint64_t i = 0; i < 100; ++i)
+    map[i] = Point{static_cast<std::int32_t>(i), 0.0};
+  aisdi::save(map, image.path);
+
+  flipByte(image.path, -7);
+
+  BOOST_CHECK_THROW(Mapped::open(image.path), std::runtime_error);
+  BOOST_CHECK_NO_THROW(Mapped::open(image.path, false));
+}
+
+BOOST_AUTO_TEST_CASE(GivenCorruptedSeedInHeader_WhenOpeningMapped_ThenChecksumCatchesIt)
+{
+  ImageFile image("MappedHashMapTests.header.img");
+  Map map;
+  for (std::uint64_t i = 0; i < 100; ++i)
+    map[i] = Point{static_cast<std::int32_t>(i), 0.0};
+  map.setHashSeed(0x5eed);
+  aisdi::save(map, image.path);
+
+  flipByte(image.path, offsetof(aisdi::MappedImageHeader, seed), std::ios::beg);
+
+  BOOST_CHECK_THROW(Mapped::open(image.path), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(GivenHeaderSizesThatWrapAround_WhenOpeningMappedWithoutVerifying_ThenLayoutIsRejected)
+{
+  ImageFile image("MappedHashMapTests.hostile.img");
+  Map map;
+  for (std::uint64_t i = 0; i < 100; ++i)
+    map[i] = Point{static_cast<std::int32_t>(i), 0.0};
+
+  // sizes whose byte counts overflow 64 bits to almost nothing
+  const std::uint64_t entriesWrapping = (std::uint64_t(1) << 63) / sizeof(Mapped::value_type) * 2;
+  const std::uint64_t bucketsWrapping = std::uint64_t(1) << 61;
+
+  aisdi::save(map, image.path);
+  overwriteWord(image.path, offsetof(aisdi::MappedImageHeader, size), entriesWrapping);
+  BOOST_CHECK_THROW(Mapped::open(image.path, false), std::runtime_error);
+
+  aisdi::save(map, image.path);
+  overwriteWord(image.path, offsetof(aisdi::MappedImageHeader, bucketCount), bucketsWrapping);
+  BOOST_CHECK_THROW(Mapped::open(image.path, false), std::runtime_error);
+
+  aisdi::save(map, image.path);
+  overwriteWord(image.path, offsetof(aisdi::MappedImageHeader, size), 99);
+  BOOST_CHECK_THROW(Mapped::open(image.path, false), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(GivenConcurrentSavesToOnePath_WhenOpeningMapped_ThenImageIsOneOfThemWhole)
+{
+  ImageFile image("MappedHashMapTests.concurrent.img");
+  Map small;
+  Map large;
+  for (std::uint64_t i = 0; i < 100; ++i)
+    small[i] = Point{1, 1.0};
+  for (std::uint64_t i = 0; i < 20000; ++i)
+    large[i] = Point{2, 2.0};
+
+  std::thread other([&]
+  {
+    for (int i = 0; i < 20; ++i)
+      aisdi::save(large, image.path);
+  });
+  for (int i = 0; i < 20; ++i)
+    aisdi::save(small, image.path);
+  other.join();
+
+  const auto mapped = Mapped::open(image.path);
+  BOOST_CHECK(mapped.getSize() == small.getSize() || mapped.getSize() == large.getSize());
+}
+
+BOOST_AUTO_TEST_CASE(GivenMissingDirectory_WhenSaving_ThenOperationThrows)
+{
+  Map map;
+  map[1] = Point{1, 1.0};
+
+  BOOST_CHECK_THROW(aisdi::save(map, "MappedHashMapTests.missing/map.img"), std::system_error);
+}
+
+BOOST_AUTO_TEST_CASE(GivenImageOfOtherTypes_WhenOpeningMapped_ThenOperationThrows)
+{
+  ImageFile image("MappedHashMapTests.types.img");
+  aisdi::HashMap<std::uint64_t, std::uint64_t> map;
+  map[1] = 2;
+  aisdi::save(map, image.path);
+
+  BOOST_CHECK_THROW(Mapped::open(image.path), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMissingOrForeignFile_WhenOpeningMapped_ThenOperationThrows)
+{
+  ImageFile image("MappedHashMapTests.foreign.img");
+  std::ofstream(image.path) << "not a hash map image, just some text that is long enough to hold a header";
+
+  BOOST_CHECK_THROW(Mapped::open("MappedHashMapTests.missing.img"), std::system_error);
+  BOOST_CHECK_THROW(Mapped::open(image.path), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,65 @@
+#include <NodePool.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using Pool = aisdi::NodePool<std::string>;
+
+BOOST_AUTO_TEST_SUITE(NodePoolTests)
+
+BOOST_AUTO_TEST_CASE(GivenEmptyPool_WhenCreated_ThenNoChunkIsAllocated)
+{
+  const Pool pool;
+
+  BOOST_CHECK_EQUAL(pool.getChunkCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(GivenPool_WhenCreatingManyNodes_ThenTheyAreCarvedFromFewGrowingChunks)
+{
+  Pool pool;
+  std::vector<std::string*> nodes;
+
+  for (int i = 0; i < 1000; ++i)
+    nodes.push_back(pool.create(std::to_string(i)));
+
+  BOOST_CHECK_EQUAL(*nodes[0], "0");
+  BOOST_CHECK_EQUAL(*nodes[999], "999");
+  BOOST_CHECK_EQUAL(std::set<std::string*>(nodes.begin(), nodes.end()).size(), nodes.size());
+  BOOST_CHECK_LE(pool.getChunkCount(), 7);
+
+  for (auto node : nodes)
+    pool.destroy(node);
+}
+
+BOOST_AUTO_TEST_CASE(GivenPoolWithDestroyedNode_WhenCreatingNode_ThenFreedMemoryIsReused)
+{
+  Pool pool;
+  std::string* first = pool.create("first");
+  pool.create("second");
+
+  pool.destroy(first);
+  std::string* third = pool.create("third");
+
+  BOOST_CHECK_EQUAL(third, first);
+  BOOST_CHECK_EQUAL(*third, "third");
+  BOOST_CHECK_EQUAL(pool.getChunkCount(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(GivenPoolWithChunks_WhenReleasing_ThenAllChunksAreFreed)
+{
+  Pool pool;
+  for (int i = 0; i < 100; ++i)
+    pool.destroy(pool.create(std::to_string(i)));
+
+  pool.release();
+
+  BOOST_CHECK_EQUAL(pool.getChunkCount(), 0);
+  std::string* node = pool.create("again");
+  BOOST_CHECK_EQUAL(*node, "again");
+  pool.destroy(node);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
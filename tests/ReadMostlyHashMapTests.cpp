@@ -0,0 +1,197 @@
+#include <ReadMostlyHashMap.h>
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using Map = aisdi::ReadMostlyHashMap<std::uint64_t, std::string>;
+
+namespace
+{
+
+const unsigned READERS = 6;
+
+std::string valueFor(std::uint64_t key, std::uint64_t version)
+{
+  return std::to_string(key) + ":" + std::to_string(version);
+}
+
+bool isValueOf(const std::string& value, std::uint64_t key)
+{
+  const std::string prefix = std::to_string(key) + ":";
+  return value.compare(0, prefix.size(), prefix) == 0;
+}
+
+struct Counted
+{
+  static std::atomic<int> alive;
+
+  Counted() { ++alive; }
+  Counted(const Counted&) { ++alive; }
+  ~Counted() { --alive; }
+};
+
+std::atomic<int> Counted::alive(0);
+
+// readers look keys up until the writer is done, every value they see has to belong to its key
+template <typename Writer>
+bool readWhileWriting(Map& map, std::uint64_t keys, Writer writer)
+{
+  std::atomic<bool> done(false);
+  std::atomic<bool> consistent(true);
+  std::vector<std::thread> readers;
+  for (unsigned r = 0; r < READERS; ++r)
+    readers.emplace_back([&, r]() {
+      std::uint64_t key = r;
+      while (!done.load())
+      {
+        key = (key * 7 + 1) % keys;
+        map.read(key, [&](const std::string& value) {
+          if (!isValueOf(value, key))
+            consistent = false;
+        });
+      }
+    });
+
+  writer();
+  done = true;
+  for (auto& reader : readers)
+    reader.join();
+  return consistent;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(ReadMostlyHashMapTests)
+
+BOOST_AUTO_TEST_CASE(GivenEmptyMap_WhenUsingSingleThread_ThenItBehavesLikeHashMap)
+{
+  Map map;
+  std::string value;
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(!map.find(1, value));
+  BOOST_CHECK(map.insert_or_assign(1, "One"));
+  BOOST_CHECK(!map.insert_or_assign(1, "Uno"));
+  BOOST_CHECK(map.insert_or_assign(2, "Two"));
+
+  BOOST_CHECK(map.find(1, value));
+  BOOST_CHECK_EQUAL(value, "Uno");
+  BOOST_CHECK_EQUAL(map.valueOf(2), "Two");
+  BOOST_CHECK_THROW(map.valueOf(3), std::out_of_range);
+  BOOST_CHECK_EQUAL(map.getSize(), 2);
+
+  BOOST_CHECK(map.remove(1));
+  BOOST_CHECK(!map.remove(1));
+  BOOST_CHECK(!map.contains(1));
+  BOOST_CHECK(map.contains(2));
+
+  map.clear();
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(!map.contains(2));
+}
+
+BOOST_AUTO_TEST_CASE(GivenMap_WhenInsertingManyItems_ThenAllAreFoundAfterGrowing)
+{
+  Map map;
+  for (std::uint64_t i = 0; i < 10000; ++i)
+    map.insert_or_assign(i, valueFor(i, 0));
+
+  BOOST_CHECK_EQUAL(map.getSize(), 10000);
+  for (std::uint64_t i = 0; i < 10000; ++i)
+    BOOST_CHECK_EQUAL(map.valueOf(i), valueFor(i, 0));
+}
+
+BOOST_AUTO_TEST_CASE(GivenNoReaders_WhenUpdatingRepeatedly_ThenRetiredNodesAreFreed)
+{
+  {
+    aisdi::ReadMostlyHashMap<int, Counted> map;
+    for (int i = 0; i < 100; ++i)
+      map.insert_or_assign(i, Counted());
+    for (int round = 0; round < 50; ++round)
+      for (int i = 0; i < 100; ++i)
+        map.insert_or_assign(i, Counted());
+
+    BOOST_CHECK_LE(map.getRetiredCount(), 128);
+    BOOST_CHECK_LE(Counted::alive.load(), 100 + 128);
+  }
+  BOOST_CHECK_EQUAL(Counted::alive.load(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(GivenPinnedReader_WhenUpdating_ThenReplacedNodeStaysReadable)
+{
+  Map map;
+  map.insert_or_assign(1, valueFor(1, 0));
+
+  map.read(1, [&](const std::string& value) {
+    for (std::uint64_t version = 1; version < 1000; ++version)
+      map.insert_or_assign(1, valueFor(1, version));
+    BOOST_CHECK_EQUAL(value, valueFor(1, 0));
+  });
+
+  BOOST_CHECK_EQUAL(map.valueOf(1), valueFor(1, 999));
+}
+
+BOOST_AUTO_TEST_CASE(GivenReadOfAnotherMapInsideRead_WhenUpdating_ThenOuterReadStaysPinned)
+{
+  Map outer;
+  Map inner;
+  outer.insert_or_assign(1, valueFor(1, 0));
+  inner.insert_or_assign(2, valueFor(2, 0));
+
+  outer.read(1, [&](const std::string& value) {
+    inner.read(2, [](const std::string&) {});
+    for (std::uint64_t version = 1; version < 1000; ++version)
+      outer.insert_or_assign(1, valueFor(1, version));
+    BOOST_CHECK_EQUAL(value, valueFor(1, 0));
+  });
+
+  BOOST_CHECK_EQUAL(outer.valueOf(1), valueFor(1, 999));
+}
+
+BOOST_AUTO_TEST_CASE(GivenConcurrentReaders_WhenWriterGrowsMap_ThenReadersSeeConsistentValues)
+{
+  const std::uint64_t keys = 20000;
+  Map map;
+
+  const bool consistent = readWhileWriting(map, keys, [&]() {
+    for (std::uint64_t i = 0; i < keys; ++i)
+      map.insert_or_assign(i, valueFor(i, 0));
+  });
+
+  BOOST_CHECK(consistent);
+  BOOST_CHECK_EQUAL(map.getSize(), keys);
+}
+
+BOOST_AUTO_TEST_CASE(GivenConcurrentReaders_WhenWriterUpdatesAndRemoves_ThenReadersSeeConsistentValues)
+{
+  const std::uint64_t keys = 512;
+  Map map;
+  for (std::uint64_t i = 0; i < keys; ++i)
+    map.insert_or_assign(i, valueFor(i, 0));
+
+  const bool consistent = readWhileWriting(map, keys, [&]() {
+    for (std::uint64_t version = 1; version <= 100; ++version)
+      for (std::uint64_t i = version % 3; i < keys; i += 3) {
+        if (version % 4 == 0)
+          map.remove(i);
+        else
+          map.insert_or_assign(i, valueFor(i, version));
+      }
+  });
+
+  BOOST_CHECK(consistent);
+  for (std::uint64_t i = 0; i < keys; ++i)
+  {
+    std::string value;
+    if (map.find(i, value))
+      BOOST_CHECK(isValueOf(value, i));
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
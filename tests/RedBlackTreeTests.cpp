@@ -0,0 +1,142 @@
+#include <RedBlackTree.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+
+struct IntNode : aisdi::RedBlackLinks
+{
+  int value;
+};
+
+class IntTree : public aisdi::RedBlackTree
+{
+public:
+  void insert(IntNode* node)
+  {
+    aisdi::RedBlackLinks* parent = nullptr;
+    bool asLeft = false;
+    for (aisdi::RedBlackLinks* at = root; at; at = asLeft ? at->left : at->right)
+    {
+      parent = at;
+      asLeft = node->value < static_cast<IntNode*>(at)->value;
+    }
+    insertAt(parent, asLeft, node);
+  }
+};
+
+// returns the black height, failing the test when a red-black rule or a subtree size is broken
+int checkSubtree(const aisdi::RedBlackLinks* node, const aisdi::RedBlackLinks* parent)
+{
+  if (!node)
+    return 1;
+  BOOST_REQUIRE(node->parent == parent);
+  BOOST_REQUIRE_EQUAL(node->size, aisdi::RedBlackTree::sizeOf(node->left) + aisdi::RedBlackTree::sizeOf(node->right) + 1);
+  if (node->red)
+  {
+    BOOST_REQUIRE(!node->left || !node->left->red);
+    BOOST_REQUIRE(!node->right || !node->right->red);
+  }
+  const int left = checkSubtree(node->left, node);
+  const int right = checkSubtree(node->right, node);
+  BOOST_REQUIRE_EQUAL(left, right);
+  return left + (node->red ? 0 : 1);
+}
+
+std::vector<int> inOrder(const IntTree& tree)
+{
+  std::vector<int> result;
+  if (tree.isEmpty())
+    return result;
+  for (auto node = tree.getLeftmost(); node; node = aisdi::RedBlackTree::next(node))
+    result.push_back(static_cast<IntNode*>(node)->value);
+  return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(RedBlackTreeTests)
+
+BOOST_AUTO_TEST_CASE(GivenEmptyTree_WhenCreated_ThenItHasNoRoot)
+{
+  const IntTree tree;
+
+  BOOST_CHECK(tree.isEmpty());
+  BOOST_CHECK(tree.getRoot() == nullptr);
+  BOOST_CHECK(tree.getLeftmost() == nullptr);
+  BOOST_CHECK(tree.getRightmost() == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(GivenAscendingInserts_WhenBalancing_ThenTreeStaysShallow)
+{
+  std::vector<IntNode> nodes(1024);
+  IntTree tree;
+
+  for (int i = 0; i < 1024; ++i)
+  {
+    nodes[i].value = i;
+    tree.insert(&nodes[i]);
+  }
+
+  BOOST_CHECK(!tree.getRoot()->red);
+  BOOST_CHECK_LE(checkSubtree(tree.getRoot(), nullptr), 11);
+  const std::vector<int> values = inOrder(tree);
+  BOOST_CHECK_EQUAL(values.size(), 1024);
+  BOOST_CHECK(std::is_sorted(values.begin(), values.end()));
+}
+
+BOOST_AUTO_TEST_CASE(GivenRandomInsertsAndErases_WhenCheckingTree_ThenRulesHoldAndOrderIsKept)
+{
+  std::mt19937 random(1234);
+  std::vector<IntNode> nodes(2000);
+  std::vector<int> expected;
+  IntTree tree;
+
+  for (int i = 0; i < 2000; ++i)
+  {
+    nodes[i].value = static_cast<int>(random() % 100000);
+    tree.insert(&nodes[i]);
+    expected.push_back(nodes[i].value);
+  }
+  std::vector<int> order(2000);
+  for (int i = 0; i < 2000; ++i)
+    order[i] = i;
+  std::shuffle(order.begin(), order.end(), random);
+  for (int i = 0; i < 1500; ++i)
+  {
+    tree.erase(&nodes[order[i]]);
+    expected.erase(std::find(expected.begin(), expected.end(), nodes[order[i]].value));
+    if (i % 100 == 0)
+      checkSubtree(tree.getRoot(), nullptr);
+    BOOST_REQUIRE(tree.getLeftmost() == aisdi::RedBlackTree::minimum(tree.getRoot()));
+    BOOST_REQUIRE(tree.getRightmost() == aisdi::RedBlackTree::maximum(tree.getRoot()));
+  }
+
+  std::sort(expected.begin(), expected.end());
+  checkSubtree(tree.getRoot(), nullptr);
+  BOOST_CHECK(inOrder(tree) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(GivenTree_WhenWalkingBackward_ThenValuesComeInDescendingOrder)
+{
+  std::vector<IntNode> nodes(10);
+  IntTree tree;
+  for (int i = 0; i < 10; ++i)
+  {
+    nodes[i].value = (i * 7) % 10;
+    tree.insert(&nodes[i]);
+  }
+
+  std::vector<int> values;
+  for (auto node = tree.getRightmost(); node; node = aisdi::RedBlackTree::prev(node))
+    values.push_back(static_cast<IntNode*>(node)->value);
+
+  BOOST_CHECK((values == std::vector<int>{9, 8, 7, 6, 5, 4, 3, 2, 1, 0}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,8 +1,11 @@
 #include <TreeMap.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <random>
 #include <string>
 #include <map>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
@@ -16,6 +19,52 @@ using Map = aisdi::TreeMap<K, std::string>;
 using std::begin;
 using std::end;
 
+// exposes the red-black tree behind a map
+template <typename K>
+struct InspectedMap : Map<K>
+{
+  InspectedMap() = default;
+
+  explicit InspectedMap(Map<K>&& map) : Map<K>(std::move(map))
+  {}
+
+  std::size_t getHeight() const
+  {
+    return heightOf(this->tree.getRoot());
+  }
+
+  // colours, black heights, parent links and subtree sizes all as a red-black tree needs them
+  bool isValid() const
+  {
+    const aisdi::RedBlackLinks* root = this->tree.getRoot();
+    return (!root || (!root->red && !root->parent)) && blackHeightOf(root) >= 0;
+  }
+
+  static std::size_t heightOf(const aisdi::RedBlackLinks* node)
+  {
+    return node ? 1 + std::max(heightOf(node->left), heightOf(node->right)) : 0;
+  }
+
+  // -1 when a rule is broken in the subtree
+  static int blackHeightOf(const aisdi::RedBlackLinks* node)
+  {
+    if (!node)
+      return 0;
+    for (const aisdi::RedBlackLinks* child : { node->left, node->right })
+    {
+      if (child && (child->parent != node || (node->red && child->red)))
+        return -1;
+    }
+    if (node->size != aisdi::RedBlackTree::sizeOf(node->left) + aisdi::RedBlackTree::sizeOf(node->right) + 1)
+      return -1;
+    const int left = blackHeightOf(node->left);
+    const int right = blackHeightOf(node->right);
+    if (left < 0 || left != right)
+      return -1;
+    return left + (node->red ? 0 : 1);
+  }
+};
+
 BOOST_AUTO_TEST_SUITE(TreeMapsTests)
 
 template <typename K>
@@ -644,6 +693,266 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenRemovingTheMostRightWhichHasL
   BOOST_CHECK_EQUAL((--end(map))->second, "Hammond");
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSortedKeys_WhenAddingAndRemovingThem_ThenTreeStaysBalanced,
+                              K,
+                              TestedKeyTypes)
+{
+  InspectedMap<K> ascending;
+  InspectedMap<K> descending;
+  for (int i = 0; i < 4095; ++i)
+  {
+    ascending[static_cast<K>(i)] = std::to_string(i);
+    descending[static_cast<K>(4094 - i)] = std::to_string(4094 - i);
+  }
+
+  BOOST_CHECK_LE(ascending.getHeight(), 24);
+  BOOST_CHECK_LE(descending.getHeight(), 24);
+
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 4095; ++i)
+  {
+    if (i % 4)
+      ascending.remove(static_cast<K>(i));
+    else
+      expected[static_cast<K>(i)] = std::to_string(i);
+  }
+  BOOST_CHECK_LE(ascending.getHeight(), 2 * 10);
+  thenMapContainsItems(ascending, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenRandomInsertsAndRemovals_WhenComparingWithStdMap_ThenContentsAndOrderMatch,
+                              K,
+                              TestedKeyTypes)
+{
+  InspectedMap<K> map;
+  std::map<K, std::string> expected;
+  std::mt19937 random(2016);
+
+  for (int i = 0; i < 20000; ++i)
+  {
+    const K key = static_cast<K>(random() % 2048);
+    if (random() % 3 == 0 && expected.count(key))
+    {
+      map.remove(key);
+      expected.erase(key);
+    }
+    else
+    {
+      map[key] = std::to_string(i);
+      expected[key] = std::to_string(i);
+    }
+  }
+
+  thenMapContainsItems(map, expected);
+  auto expectedIt = expected.begin();
+  for (auto it = map.begin(); it != map.end(); ++it, ++expectedIt)
+    BOOST_CHECK_EQUAL(it->first, expectedIt->first);
+  BOOST_CHECK_LE(map.getHeight(), 2 * 11);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMapOfNonStringValues_WhenAddingWithSubscript_ThenValueStartsInitialized)
+{
+  aisdi::TreeMap<int, int> map;
+
+  map[3] += 4;
+  ++map[3];
+
+  BOOST_CHECK_EQUAL(map.valueOf(3), 5);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenLookingForBounds_ThenTheyPointAtNeighbouringKeys,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 10, "a" }, { 20, "b" }, { 30, "c" } };
+
+  BOOST_CHECK_EQUAL(map.lower_bound(20)->first, 20);
+  BOOST_CHECK_EQUAL(map.upper_bound(20)->first, 30);
+  BOOST_CHECK_EQUAL(map.lower_bound(21)->first, 30);
+  BOOST_CHECK_EQUAL(map.upper_bound(5)->first, 10);
+  BOOST_CHECK(map.lower_bound(31) == map.end());
+  BOOST_CHECK(map.upper_bound(30) == map.end());
+
+  const auto found = map.equal_range(20);
+  BOOST_CHECK_EQUAL(found.first->second, "b");
+  BOOST_CHECK(found.second == map.find(30));
+  const auto missing = map.equal_range(25);
+  BOOST_CHECK(missing.first == missing.second);
+  BOOST_CHECK_EQUAL(missing.first->first, 30);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenIteratingOverRange_ThenOnlyKeysInsideAreVisited,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 1000; i += 10)
+    map[static_cast<K>(i)] = std::to_string(i);
+
+  std::vector<K> visited;
+  for (auto& item : map.range(95, 150))
+  {
+    visited.push_back(item.first);
+    item.second += "!";
+  }
+
+  BOOST_CHECK((visited == std::vector<K>{ 100, 110, 120, 130, 140 }));
+  BOOST_CHECK_EQUAL(map.valueOf(100), "100!");
+  BOOST_CHECK_EQUAL(map.valueOf(150), "150");
+
+  const Map<K>& constMap = map;
+  BOOST_CHECK(constMap.range(101, 109).isEmpty());
+  BOOST_CHECK(constMap.range(200, 100).isEmpty());
+  BOOST_CHECK_EQUAL(constMap.range(990, 5000).begin()->first, 990);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenIteratingInReverse_ThenKeysComeInDescendingOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" }, { 13, "Chuck" } };
+
+  std::vector<K> keys;
+  for (auto it = map.rbegin(); it != map.rend(); ++it)
+    keys.push_back(it->first);
+  map.rbegin()->second = "Eve";
+
+  const Map<K>& constMap = map;
+  BOOST_CHECK((keys == std::vector<K>{ 42, 27, 13 }));
+  BOOST_CHECK_EQUAL(constMap.crbegin()->second, "Eve");
+  BOOST_CHECK(std::distance(constMap.rbegin(), constMap.rend()) == 3);
+  const Map<K> empty;
+  BOOST_CHECK(empty.rbegin() == empty.rend());
+}
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenRandomOperations_WhenAskingForOrderStatistics_ThenTheyMatchStdMap,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  std::mt19937 random(24);
+
+  for (int i = 0; i < 6000; ++i)
+  {
+    const K key = static_cast<K>(random() % 1000);
+    if (random() % 3 == 0 && expected.count(key))
+    {
+      map.remove(key);
+      expected.erase(key);
+    }
+    else
+    {
+      map[key] = std::to_string(i);
+      expected[key] = std::to_string(i);
+    }
+  }
+
+  std::size_t index = 0;
+  for (const auto& item : expected)
+  {
+    BOOST_CHECK_EQUAL(map.rank(item.first), index);
+    BOOST_CHECK(map.nth(index)->first == item.first);
+    BOOST_CHECK(map.select(index) == item);
+    ++index;
+  }
+  BOOST_CHECK(map.nth(expected.size()) == map.end());
+  BOOST_CHECK_THROW(map.select(expected.size()), std::out_of_range);
+
+  for (K low = 0; low < 1000; low += 37)
+  {
+    const K high = low + 100;
+    const auto expectedCount = std::distance(expected.lower_bound(low), expected.lower_bound(high));
+    BOOST_CHECK_EQUAL(map.count(low, high), static_cast<std::size_t>(expectedCount));
+    BOOST_CHECK_EQUAL(map.count(high, low), 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenAskingForRankOfMissingKeys_ThenKeysBelowAreCounted,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 10, "a" }, { 20, "b" }, { 30, "c" } };
+
+  BOOST_CHECK_EQUAL(map.rank(5), 0);
+  BOOST_CHECK_EQUAL(map.rank(25), 2);
+  BOOST_CHECK_EQUAL(map.rank(35), 3);
+  map.select(1).second = "x";
+  BOOST_CHECK_EQUAL(map.valueOf(20), "x");
+  BOOST_CHECK_EQUAL(Map<K>().rank(1), 0);
+}
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSortedEntries_WhenBuildingFromThem_ThenTreeIsPerfectlyBalanced,
+                              K,
+                              TestedKeyTypes)
+{
+  for (int size : { 0, 1, 2, 3, 7, 8, 100, 1023, 1024, 5000 })
+  {
+    std::map<K, std::string> expected;
+    for (int i = 0; i < size; ++i)
+      expected[static_cast<K>(2 * i)] = std::to_string(i);
+
+    InspectedMap<K> map(Map<K>::from_sorted(expected.begin(), expected.end()));
+
+    std::size_t height = 0;
+    while ((std::size_t(1) << height) <= static_cast<std::size_t>(size))
+      ++height;
+    BOOST_CHECK(map.isValid());
+    BOOST_CHECK_EQUAL(map.getHeight(), height);
+    thenMapContainsItems(map, expected);
+
+    map[static_cast<K>(2 * size + 1)] = "tail";
+    map[static_cast<K>(1)] = "head";
+    if (size > 1)
+      map.remove(static_cast<K>(2));
+    BOOST_CHECK(map.isValid());
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenPopulatedMap_WhenAssigningSortedEntries_ThenOldItemsAreReplaced,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+  const std::vector<std::pair<K, std::string>> entries = { { 1, "one" }, { 2, "two" }, { 3, "three" } };
+
+  map.assign_sorted(entries.begin(), entries.end());
+
+  thenMapContainsItems(map, { { 1, "one" }, { 2, "two" }, { 3, "three" } });
+  map.assign_sorted(map.begin(), map.end());
+  BOOST_CHECK_EQUAL(map.getSize(), 3);
+  BOOST_CHECK_EQUAL(map.valueOf(2), "two");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenUnsortedEntriesWithRepeatedKeys_WhenBuildingFromThem_ThenFirstOfEachKeyIsKept,
+                              K,
+                              TestedKeyTypes)
+{
+  const std::vector<std::pair<K, std::string>> entries = {
+    { 5, "five" }, { 1, "one" }, { 3, "three" }, { 1, "uno" }, { 4, "four" }, { 5, "cinco" }
+  };
+
+  InspectedMap<K> map(Map<K>::from_unsorted(entries.begin(), entries.end()));
+
+  BOOST_CHECK(map.isValid());
+  thenMapContainsItems(map, { { 1, "one" }, { 3, "three" }, { 4, "four" }, { 5, "five" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenCopying_ThenCopyIsBalancedAndIndependent,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 1000; ++i)
+    map[static_cast<K>(i)] = std::to_string(i);
+
+  InspectedMap<K> copy;
+  static_cast<Map<K>&>(copy) = map;
+  map.remove(0);
+
+  BOOST_CHECK(copy.isValid());
+  BOOST_CHECK_EQUAL(copy.getHeight(), 10);
+  BOOST_CHECK_EQUAL(copy.getSize(), 1000);
+  BOOST_CHECK_EQUAL(copy.valueOf(0), "0");
+}
 
 // ConstIterator is tested via Iterator methods.
 // If Iterator methods are to be changed, then new ConstIterator tests are required.